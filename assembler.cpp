@@ -0,0 +1,594 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "assembler.h"
+#include "cpu.h"
+#include "thread_pool.h"
+
+uint32_t assembler::stoui_offset(const std::string_view s, size_t offset) {
+    if (s.empty()) throw std::invalid_argument("Empty string");
+
+    if (offset >= s.size()) throw std::invalid_argument("Offset out of range");
+
+    const bool zero_first = s[offset] == '0';
+    const size_t len = s.size();
+    if (len - offset == 1 && zero_first) return 0;
+
+    if (zero_first) throw std::invalid_argument("Invalid number format");
+
+    unsigned int num = 0;
+    for (; offset < len; ++offset) {
+        const char c = s[offset];
+        if (c < '0' || c > '9') throw std::invalid_argument("Invalid character");
+
+        num = num * 10 + (c - '0');
+    }
+
+    return num;
+}
+uint8_t assembler::get_register_index(const std::string_view reg_name) {
+    if (reg_name.empty()) throw std::invalid_argument("Empty register");
+
+    if (reg_name.size() == 1 || reg_name.size() > 4) throw std::invalid_argument("Invalid register name: " + std::string(reg_name));
+
+    switch (reg_name[0]) {
+        case 'x': {
+            const auto i = stoui_offset(reg_name, 1);
+            if (i > 31) throw std::invalid_argument("Bad register index: " + std::string(reg_name));
+
+            return i;
+        }
+
+        case 'z': {
+            if (reg_name != "zero") throw std::invalid_argument("Invalid register: " + std::string(reg_name));
+
+            return ZERO;
+        }
+
+        case 'r': {
+            if (reg_name != "ra") throw std::invalid_argument("Invalid register: " + std::string(reg_name));
+
+            return RA;
+        }
+
+        case 'g': {
+            if (reg_name != "gp") throw std::invalid_argument("Invalid register: " + std::string(reg_name));
+
+            return GP;
+        }
+
+        case 't': {
+            if (reg_name == "tp") return TP;
+
+            const auto i = stoui_offset(reg_name, 1);
+            if (i > 6) throw std::invalid_argument("Bad register index: " + std::string(reg_name));
+
+            if (i <= 2) return T0 + i;
+
+            return T3 + (i - 3);
+        }
+
+        case 's': {
+            if (reg_name == "sp") return SP;
+
+            const auto i = stoui_offset(reg_name, 1);
+            if (i > 11) throw std::invalid_argument("Bad register index: " + std::string(reg_name));
+
+            if (i <= 1) return S0 + i;
+
+            return S2 + (i - 2);
+        }
+
+        case 'a': {
+            const auto i = stoui_offset(reg_name, 1);
+            if (i > 7) throw std::invalid_argument("Bad register index: " + std::string(reg_name));
+
+            return A0 + i;
+        }
+
+        case 'f': {
+            if (reg_name != "fp") throw std::invalid_argument("Invalid register: " + std::string(reg_name));
+
+            return FP;
+        }
+
+        default:
+            throw std::invalid_argument("Register not implemented yet, did you discover a new one?: " + std::string(reg_name));
+    }
+}
+// decimal, 0x hex, 0b binary or a 'c' char literal, the whole token has to be the number
+bool assembler::parse_number(std::string_view s, int64_t &value) {
+    if (s.size() >= 3 && s.front() == '\'' && s.back() == '\'') {
+        s = s.substr(1, s.size() - 2);
+        if (s.size() == 1 && s[0] != '\\' && s[0] != '\'') {
+            value = static_cast<unsigned char>(s[0]);
+            return true;
+        }
+        if (s.size() != 2 || s[0] != '\\') return false;
+
+        switch (s[1]) {
+            case 'n':  value = '\n'; return true;
+            case 't':  value = '\t'; return true;
+            case 'r':  value = '\r'; return true;
+            case '0':  value = '\0'; return true;
+            case '\\': value = '\\'; return true;
+            case '\'': value = '\''; return true;
+            case '"':  value = '"'; return true;
+            default:   return false;
+        }
+    }
+
+    const bool negative = !s.empty() && s.front() == '-';
+    if (!s.empty() && (s.front() == '-' || s.front() == '+')) s.remove_prefix(1);
+
+    int base = 10;
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) base = 16;
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) base = 2;
+    if (base != 10) s.remove_prefix(2);
+
+    uint64_t magnitude = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), magnitude, base);
+    if (s.empty() || ec != std::errc() || end != s.data() + s.size() || magnitude > UINT32_MAX) return false;
+
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+int16_t assembler::get_imm12(const std::string_view s) {
+    if (s.empty()) throw std::invalid_argument("Empty imm12");
+
+    int64_t imm12 = 0;
+    if (!parse_number(s, imm12)) throw std::invalid_argument("Invalid imm12: " + std::string(s));
+
+    // signed 12 bits integer
+    if (imm12 < -2048 || imm12 > 2047) throw std::invalid_argument("Invalid imm12 range: " + std::string(s));
+
+    return static_cast<int16_t>(imm12);
+}
+int32_t assembler::get_imm20(const std::string_view s) {
+    if (s.empty()) throw std::invalid_argument("Empty imm20");
+
+    int64_t imm20 = 0;
+    if (!parse_number(s, imm20)) throw std::invalid_argument("Invalid imm20: " + std::string(s));
+
+    // signed 20bits integer
+    if (imm20 < -524288 || imm20 > 524287) throw std::invalid_argument("Invalid imm20 range: " + std::string(s));
+
+    return static_cast<int32_t>(imm20);
+}
+std::pair<int16_t, uint8_t> assembler::get_offset_register(const std::string_view s) {
+    // imm(reg), the immediate can be left out
+    const size_t open = s.find('(');
+    if (open == std::string_view::npos || s.back() != ')') throw std::invalid_argument("Invalid memory operand: " + std::string(s));
+
+    const int16_t imm12 = open == 0 ? 0 : get_imm12(s.substr(0, open));
+    return {imm12, get_register_index(s.substr(open + 1, s.size() - open - 2))};
+}
+std::string_view assembler::skip_blanks(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    return s;
+}
+bool assembler::is_comment(const char c) const {
+    for (const auto &com : _valid_com_chars)
+        if (c == com) return true;
+
+    return false;
+}
+bool assembler::is_valid_label(const std::string_view name) {
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) return false;
+
+    for (const char c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.' && c != '$') return false;
+
+    return true;
+}
+void assembler::extract_labels(std::string_view &inst, const uint32_t index,
+                               std::unordered_map<std::string_view, uint32_t> &labels) const {
+    inst = skip_blanks(inst);
+    while (!inst.empty() && !is_comment(inst.front())) {
+        const size_t token_end = inst.find_first_of(" \t");
+        const size_t colon = inst.find(':');
+        if (colon == std::string_view::npos || colon > token_end) return;
+
+        const std::string_view name = inst.substr(0, colon);
+        if (!is_valid_label(name)) throw std::invalid_argument("Invalid label: " + std::string(name));
+
+        if (!labels.emplace(name, index).second) throw std::invalid_argument("Duplicate label: " + std::string(name));
+
+        inst = skip_blanks(inst.substr(colon + 1));
+    }
+}
+std::string_view assembler::skip_labels(std::string_view inst) const {
+    while (!inst.empty() && !is_comment(inst.front())) {
+        const size_t colon = inst.find(':');
+        if (colon == std::string_view::npos || colon > inst.find_first_of(" \t")) break;
+
+        inst = skip_blanks(inst.substr(colon + 1));
+    }
+    return inst;
+}
+int32_t assembler::resolve_target(const std::string_view label, const size_t index) const {
+    const auto it = _symbols.find(label);
+    if (it == _symbols.end()) throw std::invalid_argument("Undefined label: " + std::string(label));
+
+    return (static_cast<int32_t>(it->second) - static_cast<int32_t>(index)) * 4;
+}
+std::string assembler::format_error(const uint64_t line_number, const std::string_view debug_line, const std::string &msg) {
+    return "\n"
+           "==================== CPU EXCEPTION ====================\n"
+           " [?] Location:    line " + std::to_string(line_number) + "\n"
+           " [!] Instruction: " + std::string(debug_line) + "\n"
+           " [X] Error:       " + msg + "\n"
+           "=======================================================\n";
+}
+const std::vector<std::string> &assembler::errors() const {
+    return _errors;
+}
+
+void assembler::check_args(const bool args_ok, const opcode op) {
+    if (!args_ok)
+        throw std::invalid_argument("Number of args is invalid: " + std::string(mnemonic(op)));
+}
+
+instruction assembler::decode_none(const bool args_ok, const opcode op) {
+    check_args(args_ok, op);
+
+    return {op, 0, 0, 0, 0};
+}
+
+instruction assembler::decode_rd_rs1(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, op);
+
+    return {op, get_register_index(arg1), get_register_index(arg2), 0, 0};
+}
+
+instruction assembler::decode_rd_imm12(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, op);
+
+    return {op, get_register_index(arg1), 0, 0, get_imm12(arg2)};
+}
+
+instruction assembler::decode_rd_imm20(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, op);
+
+    return {op, get_register_index(arg1), 0, 0, get_imm20(arg2)};
+}
+
+instruction assembler::decode_rd_rs1_rs2(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3) {
+    check_args(args_ok, op);
+
+    return {op, get_register_index(arg1), get_register_index(arg2), get_register_index(arg3), 0};
+}
+
+instruction assembler::decode_rd_rs1_imm12(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3) {
+    check_args(args_ok, op);
+
+    return {op, get_register_index(arg1), get_register_index(arg2), 0, get_imm12(arg3)};
+}
+
+instruction assembler::decode_rd_rs1_shamt(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3) {
+    check_args(args_ok, op);
+
+    // only the low 5 bits are used as shift amount
+    return {op, get_register_index(arg1), get_register_index(arg2), 0, get_imm12(arg3) & 0x1f};
+}
+
+instruction assembler::decode_rs1(const bool args_ok, const opcode op, std::string_view arg1) {
+    check_args(args_ok, op);
+
+    return {op, 0, get_register_index(arg1), 0, 0};
+}
+
+instruction assembler::decode_load(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, op);
+
+    const auto [imm12, rs1] = get_offset_register(arg2);
+    return {op, get_register_index(arg1), rs1, 0, imm12};
+}
+
+instruction assembler::decode_store(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, op);
+
+    // the value register comes first but is rs2 in the encoding
+    const auto [imm12, rs1] = get_offset_register(arg2);
+    return {op, 0, rs1, get_register_index(arg1), imm12};
+}
+
+// lr.w rd, (rs1) has no rs2, the address operand is always last and cannot have an offset
+instruction assembler::decode_amo(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3) {
+    check_args(args_ok, op);
+
+    const auto [imm12, rs1] = get_offset_register(op == opcode::LR_W ? arg2 : arg3);
+    if (imm12 != 0) throw std::invalid_argument("Atomic memory operands take no offset: " + std::string(op == opcode::LR_W ? arg2 : arg3));
+
+    return {op, get_register_index(arg1), rs1, op == opcode::LR_W ? uint8_t{0} : get_register_index(arg2), 0};
+}
+
+instruction assembler::decode_csrr(const bool args_ok, std::string_view arg1, std::string_view arg2) {
+    check_args(args_ok, opcode::CSRR);
+
+    if (arg2 != "mhartid") throw std::invalid_argument("Unsupported csr: " + std::string(arg2));
+    return {opcode::CSRR, get_register_index(arg1), 0, 0, CSR_MHARTID};
+}
+
+// the .aq and .rl bits are dropped, every atomic is sequentially consistent anyway
+void assembler::strip_ordering(std::string_view &op) {
+    if (!op.starts_with("lr.") && !op.starts_with("sc.") && !op.starts_with("amo")) return;
+
+    for (const std::string_view suffix : {".aqrl", ".aq", ".rl"})
+        if (op.ends_with(suffix)) {
+            op.remove_suffix(suffix.size());
+            return;
+        }
+}
+
+instruction assembler::decode_target(const bool args_ok, const opcode op, std::string_view arg1, const size_t index) const {
+    check_args(args_ok, op);
+
+    return {op, 0, 0, 0, resolve_target(arg1, index)};
+}
+
+instruction assembler::decode_jal(const size_t args, std::string_view arg1, std::string_view arg2, const size_t index) const {
+    // jal label is jal ra, label
+    if (args == 1) return {opcode::JAL, RA, 0, 0, resolve_target(arg1, index)};
+
+    check_args(args == 2, opcode::JAL);
+
+    return {opcode::JAL, get_register_index(arg1), 0, 0, resolve_target(arg2, index)};
+}
+
+instruction assembler::decode_jalr(const size_t args, std::string_view arg1, std::string_view arg2, std::string_view arg3) {
+    // jalr rs is jalr ra, rs, 0 and jalr rd, imm(rs1) is jalr rd, rs1, imm
+    if (args == 1) return {opcode::JALR, RA, get_register_index(arg1), 0, 0};
+
+    if (args == 2) {
+        const auto [imm12, rs1] = get_offset_register(arg2);
+        return {opcode::JALR, get_register_index(arg1), rs1, 0, imm12};
+    }
+
+    check_args(args == 3, opcode::JALR);
+
+    return {opcode::JALR, get_register_index(arg1), get_register_index(arg2), 0, get_imm12(arg3)};
+}
+
+instruction assembler::decode_rs1_rs2_target(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3, const size_t index) const {
+    check_args(args_ok, op);
+
+    return {op, 0, get_register_index(arg1), get_register_index(arg2), resolve_target(arg3, index)};
+}
+
+instruction assembler::decode_rs1_target(const bool args_ok, const opcode op, std::string_view arg1, std::string_view arg2, const size_t index, const bool swap) const {
+    check_args(args_ok, op);
+
+    // compare against x0, swap puts x0 on the left side
+    const uint8_t rs = get_register_index(arg1);
+    if (swap) return {op, 0, ZERO, rs, resolve_target(arg2, index)};
+
+    return {op, 0, rs, ZERO, resolve_target(arg2, index)};
+}
+
+// only built for error messages, in the shape the line was written
+std::string assembler::debug_line(const std::string_view op, const std::string_view arg1, const std::string_view arg2, const std::string_view arg3) {
+    std::string line(op);
+    if (!arg1.empty()) line.append(" ").append(arg1);
+    if (!arg2.empty()) line.append(", ").append(arg2);
+    if (!arg3.empty()) line.append(", ").append(arg3);
+    return line;
+}
+
+std::optional<instruction> assembler::decode_instruction(const std::string_view inst, const uint64_t line_number, const size_t index) const {
+    // blanks and commas separate tokens, a comment character starting a token ends the
+    // line and a char literal is one token even when it holds a separator. tokens past
+    // the third operand are ignored
+    std::string_view op, arg1, arg2, arg3;
+    std::string_view *const tokens[] = {&op, &arg1, &arg2, &arg3};
+    size_t count = 0;
+    for (size_t i = 0; count < std::size(tokens);) {
+        while (i < inst.size() && (inst[i] == ' ' || inst[i] == '\t' || inst[i] == ',')) ++i;
+        if (i == inst.size() || is_comment(inst[i])) break;
+
+        size_t end = i + 1;
+        if (inst[i] == '\'') {
+            while (end < inst.size() && inst[end] != '\'') end += inst[end] == '\\' ? 2 : 1;
+            end = std::min(end + 1, inst.size());
+        }
+        while (end < inst.size() && inst[end] != ' ' && inst[end] != '\t' && inst[end] != ',') ++end;
+
+        *tokens[count++] = inst.substr(i, end - i);
+        i = end;
+    }
+    if (op.empty()) return std::nullopt;
+
+    const size_t args = count - 1;
+    strip_ordering(op);
+    try {
+        const isa_syntax *const syntax = find_mnemonic(op);
+        if (!syntax) throw std::invalid_argument("Operation not implemented: " + std::string(op));
+
+        const opcode code = syntax->op;
+        switch (syntax->format) {
+            case operands::NONE:               return decode_none(args == 0, code);
+            case operands::IGNORED:            return instruction{code, 0, 0, 0, 0};
+            case operands::TARGET:             return decode_target(args == 1, code, arg1, index);
+            case operands::RS1:                return decode_rs1(args == 1, code, arg1);
+            case operands::RD_RS1:             return decode_rd_rs1(args == 2, code, arg1, arg2);
+            case operands::RD_IMM12:           return decode_rd_imm12(args == 2, code, arg1, arg2);
+            case operands::RD_IMM20:           return decode_rd_imm20(args == 2, code, arg1, arg2);
+            case operands::RD_CSR:             return decode_csrr(args == 2, arg1, arg2);
+            case operands::RS1_TARGET:         return decode_rs1_target(args == 2, code, arg1, arg2, index);
+            case operands::RS1_TARGET_SWAPPED: return decode_rs1_target(args == 2, code, arg1, arg2, index, true);
+            case operands::LOAD:               return decode_load(args == 2, code, arg1, arg2);
+            case operands::STORE:              return decode_store(args == 2, code, arg1, arg2);
+            case operands::RD_RS1_RS2:         return decode_rd_rs1_rs2(args == 3, code, arg1, arg2, arg3);
+            case operands::RD_RS1_IMM12:       return decode_rd_rs1_imm12(args == 3, code, arg1, arg2, arg3);
+            case operands::RD_RS1_SHAMT:       return decode_rd_rs1_shamt(args == 3, code, arg1, arg2, arg3);
+            case operands::RS1_RS2_TARGET:     return decode_rs1_rs2_target(args == 3, code, arg1, arg2, arg3, index);
+            case operands::JAL:                return decode_jal(args, arg1, arg2, index);
+            case operands::JALR:               return decode_jalr(args, arg1, arg2, arg3);
+            case operands::LR:                 return decode_amo(args == 2, code, arg1, arg2, arg3);
+            case operands::AMO:                return decode_amo(args == 3, code, arg1, arg2, arg3);
+            case operands::FUSED:              break;
+        }
+        throw std::invalid_argument("Operation not implemented: " + std::string(op));
+    } catch (std::invalid_argument& e) {
+        throw std::invalid_argument(format_error(line_number, debug_line(op, arg1, arg2, arg3), e.what()));
+    }
+}
+
+program assembler::assemble(std::istream &in) {
+    const std::string source{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return assemble(std::string_view(source));
+}
+
+std::vector<assembler::chunk> assembler::split(const std::string_view source, const size_t count) {
+    std::vector<chunk> chunks;
+    size_t start = 0;
+    for (size_t i = 1; i <= count && start < source.size(); ++i) {
+        // every chunk but the last ends right after a newline
+        size_t end = i == count ? source.size() : std::max(start, source.size() * i / count);
+        if (end < source.size()) end = std::min(source.find('\n', end), source.size() - 1) + 1;
+
+        chunks.emplace_back().source = source.substr(start, end - start);
+        start = end;
+    }
+    if (chunks.empty()) chunks.emplace_back();
+    return chunks;
+}
+
+// first pass: labels against the index of the next instruction within the chunk
+void assembler::scan(chunk &c) const {
+    c.pending.reserve(std::count(c.source.begin(), c.source.end(), '\n') + 1);
+    for (size_t start = 0; start < c.source.size();) {
+        const size_t newline = std::min(c.source.find('\n', start), c.source.size());
+        std::string_view line = c.source.substr(start, newline - start);
+        if (line.ends_with('\r')) line.remove_suffix(1);
+        start = newline + 1;
+        ++c.lines;
+
+        bool failed = false;
+        try {
+            extract_labels(line, c.pending.size(), c.labels);
+        } catch (const std::invalid_argument &e) {
+            // the rest of the line's labels are lost, an instruction after them still takes its slot
+            c.label_errors.push_back({{line, c.lines}, e.what()});
+            line = skip_labels(line);
+            failed = true;
+        }
+
+        // the same separators decode_instruction skips, a line kept here always decodes to
+        // one instruction or to the placeholder for it
+        while (!line.empty() && (line.front() == ',' || line.front() == ' ' || line.front() == '\t')) line.remove_prefix(1);
+        if (line.empty() || is_comment(line.front())) continue;
+
+        c.pending.push_back({line, c.lines, failed});
+    }
+}
+
+// second pass: every label is known, targets become offsets. a line that fails to decode
+// keeps its slot as an unimp, so the indices the labels were given in the first pass hold
+void assembler::decode(chunk &c) const {
+    c.code.clear();
+    c.code_lines.clear();
+    c.errors.clear();
+    c.code.reserve(c.pending.size());
+    c.code_lines.reserve(c.pending.size());
+    for (const auto &[text, line, failed] : c.pending) {
+        const uint64_t number = c.first_line + line;
+        if (failed) {
+            // already reported by the first pass
+            c.code.push_back({opcode::UNIMP, 0, 0, 0, 0});
+            c.code_lines.push_back(number);
+            continue;
+        }
+        try {
+            if (const auto decoded = decode_instruction(text, number, c.first_index + c.code.size())) {
+                c.code.push_back(sink_x0(*decoded));
+                c.code_lines.push_back(number);
+            }
+        } catch (const std::invalid_argument &e) {
+            c.errors.emplace_back(e.what());
+            c.code.push_back({opcode::UNIMP, 0, 0, 0, 0});
+            c.code_lines.push_back(number);
+        }
+    }
+}
+
+program assembler::assemble(const std::string_view source) {
+    const size_t threads = _threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : _threads;
+    if (source.size() < PARALLEL_ASSEMBLY_SIZE || threads == 1) return assemble(source, 1, 1);
+
+    return assemble(source, threads, std::min(threads * 4, source.size() / ASSEMBLY_CHUNK_SIZE));
+}
+
+program assembler::assemble(const std::string_view source, const size_t threads, const size_t count) {
+    program prog;
+    _errors.clear();
+    _symbols.clear();
+    std::vector<chunk> chunks = split(source, count);
+
+    // serially the chunk is just the whole source, no pool is started for it
+    std::optional<thread_pool> pool;
+    if (chunks.size() > 1) pool.emplace(threads);
+    const auto each_chunk = [&](const auto &work) {
+        if (!pool) return work(chunks.front());
+
+        for (chunk &c : chunks) pool->submit([&work, &c] { work(c); });
+        pool->wait();
+    };
+
+    // tasks must not throw, a chunk that cannot even be scanned is reported like a bad line
+    each_chunk([this](chunk &c) {
+        try {
+            scan(c);
+        } catch (const std::exception &e) {
+            c.label_errors.push_back({{{}, c.lines}, e.what()});
+        }
+    });
+
+    // the chunks' labels merge in source order, so the indices match a serial scan
+    uint64_t first_line = 0;
+    size_t first_index = 0;
+    for (chunk &c : chunks) {
+        c.first_line = first_line;
+        first_line += c.lines;
+        for (const auto &[line, message] : c.label_errors)
+            _errors.emplace_back(format_error(c.first_line + line.line_number, line.text, message));
+
+        for (const auto &[name, index] : c.labels)
+            if (!_symbols.emplace(name, first_index + index).second) {
+                // serially the second one is a bad label, only a serial pass reports it the same way
+                return assemble(source, 1, 1);
+            }
+        c.first_index = first_index;
+        first_index += c.pending.size();
+    }
+
+    each_chunk([this](chunk &c) {
+        try {
+            decode(c);
+        } catch (const std::exception &e) {
+            c.errors.emplace_back(e.what());
+        }
+    });
+
+    // every pending line took exactly one slot, the chunks land where the first pass placed them
+    prog.code.reserve(first_index);
+    prog.lines.reserve(first_index);
+    for (chunk &c : chunks) {
+        prog.code.insert(prog.code.end(), c.code.begin(), c.code.end());
+        prog.lines.insert(prog.lines.end(), c.code_lines.begin(), c.code_lines.end());
+        _errors.insert(_errors.end(), std::make_move_iterator(c.errors.begin()), std::make_move_iterator(c.errors.end()));
+    }
+
+    for (const auto &[name, index] : _symbols)
+        prog.symbols.emplace(name, prog.base + index * 4);
+
+    return prog;
+}
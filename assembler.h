@@ -0,0 +1,119 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "instruction.h"
+#include "isa.h"
+
+constexpr size_t PARALLEL_ASSEMBLY_SIZE = 1 << 20;
+constexpr size_t ASSEMBLY_CHUNK_SIZE = 256 << 10; // the smallest chunk worth a task
+
+class assembler {
+    const std::array<char, 2> _valid_com_chars = {
+        '#',
+        ';'
+    };
+
+    // labels are looked up by the string_view operands without building a string
+    struct symbol_hash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    std::vector<std::string> _errors;
+    std::unordered_map<std::string, uint32_t, symbol_hash, std::equal_to<>> _symbols; // label -> instruction index
+
+    // source line waiting for the second pass, it points into the source
+    struct pending_line {
+        std::string_view text;
+        uint64_t         line_number;
+        bool             failed = false; // its labels were rejected, the slot is an unimp
+    };
+
+    // a line aligned slice of the source. the first pass fills pending and labels, the
+    // second code, lines and errors. line numbers and indices are relative to the chunk
+    // until the merge, so chunks are assembled independently
+    struct chunk {
+        std::string_view                                    source;
+        uint64_t                                            first_line = 0; // lines before the chunk
+        uint64_t                                            lines = 0;
+        std::vector<pending_line>                           pending;
+        std::unordered_map<std::string_view, uint32_t>      labels;
+        std::vector<std::pair<pending_line, std::string>>   label_errors;
+        size_t                                              first_index = 0; // of the chunk's first instruction in the program
+        std::vector<instruction>                            code;
+        std::vector<uint64_t>                               code_lines;
+        std::vector<std::string>                            errors;
+    };
+
+    size_t                   _threads = 0;
+
+    [[nodiscard]] static bool       parse_number(std::string_view s, int64_t& value);
+    [[nodiscard]] static int16_t    get_imm12(std::string_view s);
+    [[nodiscard]] static int32_t    get_imm20(std::string_view s);
+    [[nodiscard]] static std::pair<int16_t, uint8_t> get_offset_register(std::string_view s);
+    [[nodiscard]] static std::string_view skip_blanks(std::string_view s);
+    [[nodiscard]] bool              is_comment(char c) const;
+    [[nodiscard]] static std::string debug_line(std::string_view op, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] static bool       is_valid_label(std::string_view name);
+    void                            extract_labels(std::string_view& inst, uint32_t index,
+                                                   std::unordered_map<std::string_view, uint32_t>& labels) const;
+    [[nodiscard]] std::string_view  skip_labels(std::string_view inst) const;
+    void                            scan(chunk& c) const;
+    void                            decode(chunk& c) const;
+    [[nodiscard]] static std::vector<chunk> split(std::string_view source, size_t count);
+    [[nodiscard]] program           assemble(std::string_view source, size_t threads, size_t count);
+    [[nodiscard]] int32_t           resolve_target(std::string_view label, size_t index) const;
+
+    static void                     check_args(bool args_ok, opcode op);
+
+    /* OPERAND FORMATS */
+    [[nodiscard]] static instruction decode_none(bool args_ok, opcode op);
+    [[nodiscard]] static instruction decode_rd_rs1(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2);
+    [[nodiscard]] static instruction decode_rd_imm12(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2);
+    [[nodiscard]] static instruction decode_rd_imm20(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2);
+    [[nodiscard]] static instruction decode_rd_rs1_rs2(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] static instruction decode_rd_rs1_imm12(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] static instruction decode_rd_rs1_shamt(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] static instruction decode_rs1(bool args_ok, opcode op, std::string_view arg1);
+    [[nodiscard]] static instruction decode_load(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2);
+    [[nodiscard]] static instruction decode_store(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2);
+    [[nodiscard]] static instruction decode_amo(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] static instruction decode_csrr(bool args_ok, std::string_view arg1, std::string_view arg2);
+    static void                     strip_ordering(std::string_view& op);
+    [[nodiscard]] instruction       decode_target(bool args_ok, opcode op, std::string_view arg1, size_t index) const;
+    [[nodiscard]] instruction       decode_jal(size_t args, std::string_view arg1, std::string_view arg2, size_t index) const;
+    [[nodiscard]] static instruction decode_jalr(size_t args, std::string_view arg1, std::string_view arg2, std::string_view arg3);
+    [[nodiscard]] instruction       decode_rs1_rs2_target(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, std::string_view arg3, size_t index) const;
+    [[nodiscard]] instruction       decode_rs1_target(bool args_ok, opcode op, std::string_view arg1, std::string_view arg2, size_t index, bool swap = false) const;
+public:
+    [[nodiscard]] static uint8_t    get_register_index(std::string_view reg_name);
+    static uint32_t                 stoui_offset(std::string_view s, size_t offset);
+    [[nodiscard]] static std::string format_error(uint64_t line_number, std::string_view debug_line, const std::string& msg);
+
+    [[nodiscard]] std::optional<instruction> decode_instruction(std::string_view inst, uint64_t line_number, size_t index) const;
+    // 0 uses one thread per host core, 1 always assembles serially. sources smaller than
+    // PARALLEL_ASSEMBLY_SIZE are assembled serially either way
+    void                            set_threads(size_t threads) { _threads = threads; }
+    // the source is only read, the labels and errors are the only strings built from it.
+    // the result does not depend on the thread count. a line that does not assemble is
+    // reported in errors() and becomes an unimp, which traps when it is reached
+    [[nodiscard]] program           assemble(std::string_view source);
+    [[nodiscard]] program           assemble(std::istream& in);
+    [[nodiscard]] const std::vector<std::string>& errors() const;
+};
+
+#endif //ASSEMBLER_H
@@ -0,0 +1,138 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "assembler.h"
+#include "batch.h"
+#include "loader.h"
+#include "thread_pool.h"
+
+static std::string_view status_name(const status s) {
+    switch (s) {
+        case status::RUNNING:               return "running";
+        case status::HALTED:                return "halted";
+        case status::ILLEGAL_INSTRUCTION:   return "illegal_instruction";
+        case status::MISALIGNED_PC:         return "misaligned_pc";
+        case status::LOAD_FAULT:            return "load_fault";
+        case status::STORE_FAULT:           return "store_fault";
+        case status::BREAKPOINT:            return "breakpoint";
+        case status::EXITED:                return "exited";
+    }
+    return "unknown";
+}
+
+static std::string json_escape(const std::string &s) {
+    std::ostringstream oss;
+    for (const char c : s) {
+        if (c == '"' || c == '\\')
+            oss << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+            oss << c;
+    }
+    return oss.str();
+}
+
+std::vector<batch_job> batch::parse_manifest(std::istream &in, std::vector<std::string> &errors) {
+    std::vector<batch_job> jobs;
+    std::string line;
+    for (uint64_t line_number = 1; std::getline(in, line); ++line_number) {
+        std::istringstream fields(line);
+        batch_job job;
+        if (!(fields >> job.path) || job.path.front() == '#') continue;
+
+        try {
+            for (std::string input; fields >> input;) {
+                const size_t eq = input.find('=');
+                if (eq == std::string::npos) throw std::invalid_argument("Expected reg=value: " + input);
+
+                const uint8_t reg = assembler::get_register_index(input.substr(0, eq));
+                const auto value = static_cast<uint32_t>(std::stoll(input.substr(eq + 1), nullptr, 0));
+                job.inputs.emplace_back(reg, value);
+            }
+            jobs.push_back(std::move(job));
+        } catch (const std::exception &e) {
+            errors.push_back("line " + std::to_string(line_number) + ": " + e.what());
+        }
+    }
+    return jobs;
+}
+
+batch_result batch::run_job(const batch_job &job, const engine mode, const memory_model model,
+                            const program_cache *cache) {
+    batch_result r;
+    const auto start = std::chrono::steady_clock::now();
+
+    // the jobs already keep every worker busy, a job's assembly stays on its own worker
+    assembler as;
+    as.set_threads(1);
+    program prog;
+    try {
+        prog = loader::load(job.path, as, cache);
+    } catch (const std::invalid_argument &e) {
+        r.error = e.what();
+        return r;
+    }
+    if (!as.errors().empty()) {
+        r.error = as.errors().front();
+        return r;
+    }
+
+    cpu c(DEFAULT_MEMORY_SIZE, model);
+    c.sys().capture_output();
+    c.map_segments(prog);
+    for (const auto &[reg, value] : job.inputs)
+        if (reg != ZERO) c.registers[reg] = value;
+
+    r.result = c.execute(prog, mode);
+    if (r.result != status::HALTED) r.trap = c.describe_trap(prog);
+    r.retired = c.retired;
+    r.output = c.sys().output();
+    std::copy_n(c.registers.begin(), r.registers.size(), r.registers.begin());
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+std::vector<batch_result> batch::run(const std::vector<batch_job> &jobs, const engine mode,
+                                     const memory_model model, const size_t threads, const program_cache *cache) {
+    std::vector<batch_result> results(jobs.size());
+    thread_pool pool(threads);
+    for (size_t i = 0; i < jobs.size(); ++i)
+        pool.submit([&, i] {
+            // tasks must not throw, a job that cannot even start reports why
+            try {
+                results[i] = run_job(jobs[i], mode, model, cache);
+            } catch (const std::exception &e) {
+                results[i].error = e.what();
+            }
+        });
+    pool.wait();
+    return results;
+}
+
+void batch::write_json(std::ostream &out, const std::vector<batch_job> &jobs, const std::vector<batch_result> &results) {
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const batch_result &r = results[i];
+        out << "{\"job\": " << i << ", \"program\": \"" << json_escape(jobs[i].path) << "\", ";
+        if (!r.error.empty()) {
+            out << "\"status\": \"error\", \"error\": \"" << json_escape(r.error) << "\"}\n";
+            continue;
+        }
+
+        out << "\"status\": \"" << status_name(r.result) << "\", ";
+        if (!r.trap.empty()) out << "\"trap\": \"" << json_escape(r.trap) << "\", ";
+        out << "\"retired\": " << r.retired << ", \"seconds\": " << r.seconds << ", ";
+        if (!r.output.empty()) out << "\"output\": \"" << json_escape(r.output) << "\", ";
+        out << "\"registers\": [";
+        for (size_t reg = 0; reg < r.registers.size(); ++reg)
+            out << (reg ? ", " : "") << r.registers[reg];
+        out << "]}\n";
+    }
+}
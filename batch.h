@@ -0,0 +1,54 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+#include "program_cache.h"
+
+// one manifest line: "path [reg=value ...]", values are decimal or 0x hex.
+// blank lines and lines starting with # are skipped
+struct batch_job {
+    std::string                                 path;
+    std::vector<std::pair<uint8_t, uint32_t>>   inputs; // register, value before the first instruction
+};
+
+struct batch_result {
+    std::string                 error;  // the program could not be loaded, nothing ran
+    status                      result = status::RUNNING;
+    std::string                 trap;
+    uint64_t                    retired = 0;
+    std::array<uint32_t, 32>    registers = {};
+    std::string                 output; // what the guest wrote to fd 1
+    double                      seconds = 0;
+};
+
+// every job gets its own assembler, program and cpu, the workers share nothing but
+// the read only job list and write only their own result slot. a job's guest stdout is
+// captured into its result, the host stdout only ever carries the report
+class batch {
+    [[nodiscard]] static batch_result run_job(const batch_job& job, engine mode, memory_model model,
+                                              const program_cache* cache);
+public:
+    // malformed lines are reported in errors as "line N: ..." and skipped
+    [[nodiscard]] static std::vector<batch_job>     parse_manifest(std::istream& in, std::vector<std::string>& errors);
+    // threads 0 uses one per host core, the workers share cache when one is given
+    [[nodiscard]] static std::vector<batch_result>  run(const std::vector<batch_job>& jobs, engine mode,
+                                                        memory_model model, size_t threads = 0,
+                                                        const program_cache* cache = nullptr);
+    // one JSON object per line, in manifest order
+    static void                                     write_json(std::ostream& out, const std::vector<batch_job>& jobs,
+                                                               const std::vector<batch_result>& results);
+};
+
+#endif //BATCH_H
@@ -0,0 +1,433 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "assembler.h"
+#include "cpu.h"
+
+// every kernel leaves a checksum in a0, a wrong one means the engine is broken
+struct kernel {
+    std::string_view name;
+    std::string_view source;
+    int32_t          expected;
+};
+
+static constexpr std::string_view FIB = R"(
+    li a0, 24
+    call fib
+    j done
+fib:
+    li t0, 2
+    blt a0, t0, fib_base
+    addi sp, sp, -12
+    sw ra, 8(sp)
+    sw a0, 4(sp)
+    addi a0, a0, -1
+    call fib
+    sw a0, 0(sp)
+    lw a0, 4(sp)
+    addi a0, a0, -2
+    call fib
+    lw t1, 0(sp)
+    add a0, a0, t1
+    lw ra, 8(sp)
+    addi sp, sp, 12
+fib_base:
+    ret
+done:
+    nop
+)";
+
+static constexpr std::string_view SIEVE = R"(
+    lui s0, 256
+    lui s1, 8
+    li t0, 0
+    li t2, 1
+clear:
+    add t1, s0, t0
+    sb t2, 0(t1)
+    addi t0, t0, 1
+    blt t0, s1, clear
+    li t0, 2
+outer:
+    mul t1, t0, t0
+    bge t1, s1, count
+    add t2, s0, t0
+    lbu t3, 0(t2)
+    beqz t3, next
+inner:
+    add t2, s0, t1
+    sb zero, 0(t2)
+    add t1, t1, t0
+    blt t1, s1, inner
+next:
+    addi t0, t0, 1
+    j outer
+count:
+    li a0, 0
+    li t0, 2
+tally:
+    add t1, s0, t0
+    lbu t2, 0(t1)
+    add a0, a0, t2
+    addi t0, t0, 1
+    blt t0, s1, tally
+)";
+
+static constexpr std::string_view MATMUL = R"(
+    lui s0, 256
+    lui s1, 257
+    lui s2, 258
+    li s3, 32
+    li t0, 0
+init_i:
+    li t1, 0
+init_j:
+    slli t2, t0, 5
+    add t2, t2, t1
+    slli t2, t2, 2
+    add t3, t0, t1
+    add t4, s0, t2
+    sw t3, 0(t4)
+    sub t3, t0, t1
+    add t4, s1, t2
+    sw t3, 0(t4)
+    addi t1, t1, 1
+    blt t1, s3, init_j
+    addi t0, t0, 1
+    blt t0, s3, init_i
+    li a0, 0
+    li t0, 0
+mm_i:
+    li t1, 0
+mm_j:
+    li t5, 0
+    li t2, 0
+mm_k:
+    slli t3, t0, 5
+    add t3, t3, t2
+    slli t3, t3, 2
+    add t3, s0, t3
+    lw t3, 0(t3)
+    slli t4, t2, 5
+    add t4, t4, t1
+    slli t4, t4, 2
+    add t4, s1, t4
+    lw t4, 0(t4)
+    mul t3, t3, t4
+    add t5, t5, t3
+    addi t2, t2, 1
+    blt t2, s3, mm_k
+    slli t3, t0, 5
+    add t3, t3, t1
+    slli t3, t3, 2
+    add t3, s2, t3
+    sw t5, 0(t3)
+    add a0, a0, t5
+    addi t1, t1, 1
+    blt t1, s3, mm_j
+    addi t0, t0, 1
+    blt t0, s3, mm_i
+)";
+
+static constexpr std::string_view MEMCPY = R"(
+    lui s0, 256
+    lui s1, 512
+    lui s2, 16
+    li t0, 0
+fill:
+    add t1, s0, t0
+    sw t0, 0(t1)
+    addi t0, t0, 4
+    blt t0, s2, fill
+    li s3, 16
+pass:
+    li t0, 0
+copy:
+    add t1, s0, t0
+    lw t2, 0(t1)
+    add t1, s1, t0
+    sw t2, 0(t1)
+    addi t0, t0, 4
+    blt t0, s2, copy
+    addi s3, s3, -1
+    bnez s3, pass
+    li a0, 0
+    li t0, 0
+sum:
+    add t1, s1, t0
+    lw t2, 0(t1)
+    add a0, a0, t2
+    addi t0, t0, 4
+    blt t0, s2, sum
+)";
+
+// bitwise reflected crc32 of 16 KiB of i & 0xff
+static constexpr std::string_view CRC32 = R"(
+    lui s0, 256
+    lui s1, 4
+    li t0, 0
+fill:
+    add t1, s0, t0
+    sb t0, 0(t1)
+    addi t0, t0, 1
+    blt t0, s1, fill
+    lui s2, -74872
+    addi s2, s2, 800
+    li a0, -1
+    li t0, 0
+byte:
+    add t1, s0, t0
+    lbu t2, 0(t1)
+    xor a0, a0, t2
+    li t3, 8
+bit:
+    andi t4, a0, 1
+    srli a0, a0, 1
+    beqz t4, skip
+    xor a0, a0, s2
+skip:
+    addi t3, t3, -1
+    bnez t3, bit
+    addi t0, t0, 1
+    blt t0, s1, byte
+    not a0, a0
+)";
+
+static constexpr std::string_view BUBBLE_SORT = R"(
+    lui s0, 256
+    li s1, 512
+    li t0, 0
+fill:
+    sub t1, s1, t0
+    slli t2, t0, 2
+    add t2, s0, t2
+    sw t1, 0(t2)
+    addi t0, t0, 1
+    blt t0, s1, fill
+    addi s2, s1, -1
+outer:
+    li t0, 0
+inner:
+    slli t1, t0, 2
+    add t1, s0, t1
+    lw t2, 0(t1)
+    lw t3, 4(t1)
+    ble t2, t3, ordered
+    sw t3, 0(t1)
+    sw t2, 4(t1)
+ordered:
+    addi t0, t0, 1
+    blt t0, s2, inner
+    addi s2, s2, -1
+    bgtz s2, outer
+    li a0, 0
+    li t0, 0
+check:
+    slli t1, t0, 2
+    add t1, s0, t1
+    lw t2, 0(t1)
+    mul t2, t2, t0
+    add a0, a0, t2
+    addi t0, t0, 1
+    blt t0, s1, check
+)";
+
+// arithmetic, a record in memory, a procedure call and a short string copy per iteration
+static constexpr std::string_view DHRYSTONE = R"(
+    lui s0, 256
+    li s1, 0
+    lui s2, 4
+    li a0, 0
+    li t0, 65
+    sb t0, 16(s0)
+loop:
+    addi t0, s1, 3
+    slli t1, t0, 1
+    sub t1, t1, s1
+    div t2, t1, t0
+    rem t3, t1, t0
+    add a0, a0, t2
+    xor a0, a0, t3
+    sw t1, 0(s0)
+    sw t2, 4(s0)
+    lw t4, 0(s0)
+    lw t5, 4(s0)
+    add t4, t4, t5
+    sw t4, 8(s0)
+    mv a1, t4
+    call proc
+    add a0, a0, a1
+    li t0, 0
+    li t3, 8
+copy:
+    add t1, s0, t0
+    lbu t2, 16(t1)
+    addi t2, t2, 1
+    sb t2, 32(t1)
+    addi t0, t0, 1
+    blt t0, t3, copy
+    lbu t2, 32(s0)
+    lbu t3, 16(s0)
+    bne t2, t3, differ
+    addi a0, a0, 1
+differ:
+    addi s1, s1, 1
+    blt s1, s2, loop
+    j done
+proc:
+    andi t0, a1, 7
+    beqz t0, even
+    slli a1, a1, 1
+    ret
+even:
+    srai a1, a1, 1
+    ret
+done:
+    nop
+)";
+
+static const std::vector<kernel> KERNELS = {
+    {"fib", FIB, 46368},
+    {"sieve", SIEVE, 3512},
+    {"matmul", MATMUL, 2793472},
+    {"memcpy", MEMCPY, 536838144},
+    {"crc32", CRC32, -401136912},
+    {"bubble_sort", BUBBLE_SORT, 44739072},
+    {"dhrystone", DHRYSTONE, 243470330},
+};
+
+struct engine_entry {
+    std::string_view name;
+    engine           mode;
+};
+
+static const std::vector<engine_entry> ENGINES = {
+    {"switch", engine::SWITCH},
+#ifdef RISCV_THREADED_DISPATCH
+    {"threaded", engine::THREADED},
+#endif
+    {"blocks", engine::BLOCK},
+    {"jit", engine::JIT},
+};
+
+// the time stamp counter ticks at a fixed reference rate, not the core clock, so the
+// per instruction figure it gives moves with turbo and frequency scaling
+static uint64_t host_cycles() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// a sample keeps rerunning the kernel until it has been timed for at least this long
+constexpr double MIN_SAMPLE_SECONDS = 0.1;
+
+struct sample {
+    double   seconds;
+    uint64_t cycles;
+};
+
+template <typename T>
+static T median(std::vector<T> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t repeat = 5;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::stoull(argv[++i]);
+        else {
+            std::cerr << "usage: risc_v_bench [--repeat N]" << std::endl;
+            return 1;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+
+    bool all_ok = true;
+    std::ostringstream json;
+    json << std::fixed << "{\n  \"repeat\": " << repeat << ",\n  \"results\": [";
+
+    bool first = true;
+    for (const auto &k : KERNELS) {
+        assembler as;
+        const program prog = as.assemble(k.source);
+        if (!as.errors().empty()) {
+            for (const auto &e : as.errors()) std::cerr << e << std::endl;
+            return 1;
+        }
+
+        for (const auto &e : ENGINES) {
+            cpu c;
+            const auto initial = c.registers;
+            bool ok = true;
+
+            // only execute is timed, memory and registers are put back between runs
+            const auto run = [&](sample &s) {
+                c.map_segments(prog);
+                c.registers = initial;
+
+                const auto start = std::chrono::steady_clock::now();
+                const uint64_t start_cycles = host_cycles();
+                const status result = c.execute(prog, e.mode);
+                s.cycles += host_cycles() - start_cycles;
+                s.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                ok = ok && result == status::HALTED && static_cast<int32_t>(c.registers[A0]) == k.expected;
+            };
+
+            // the warm up run builds the blocks and compiles the hot ones, the timed runs reuse them
+            sample warm_up = {};
+            run(warm_up);
+            const auto runs = static_cast<uint64_t>(std::max(1.0, std::ceil(MIN_SAMPLE_SECONDS / warm_up.seconds)));
+
+            std::vector<double> seconds;
+            std::vector<uint64_t> cycles;
+            for (uint64_t r = 0; r < repeat; ++r) {
+                sample s = {};
+                for (uint64_t i = 0; i < runs; ++i) run(s);
+                seconds.push_back(s.seconds / static_cast<double>(runs));
+                cycles.push_back(s.cycles / runs);
+            }
+            all_ok = all_ok && ok;
+
+            const uint64_t retired = c.retired;
+            const double per_run = median(seconds);
+            json << (first ? "\n" : ",\n") << "    {\"kernel\": \"" << k.name << "\", \"engine\": \"" << e.name
+                 << "\", \"ok\": " << (ok ? "true" : "false")
+                 << ", \"retired\": " << retired
+                 << ", \"runs\": " << runs
+                 << ", \"seconds\": " << std::setprecision(6) << per_run
+                 << ", \"mips\": " << std::setprecision(2) << (per_run > 0 ? static_cast<double>(retired) / per_run / 1e6 : 0.0)
+                 << ", \"ref_cycles_per_instruction\": ";
+            if (host_cycles() != 0 && retired != 0)
+                json << std::setprecision(2) << static_cast<double>(median(cycles)) / static_cast<double>(retired);
+            else
+                json << "null";
+            json << "}";
+            first = false;
+        }
+    }
+
+    json << "\n  ]\n}\n";
+    std::cout << json.str();
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include "block_cache.h"
+
+bool block_cache::is_direct(const opcode op) {
+    switch (op) {
+        case opcode::J:
+        case opcode::CALL:
+        case opcode::TAIL:
+        case opcode::JAL:
+        case opcode::BEQ:
+        case opcode::BNE:
+        case opcode::BLT:
+        case opcode::BGE:
+        case opcode::BLTU:
+        case opcode::BGEU:
+        case opcode::BGT:
+        case opcode::BLE:
+        case opcode::BGTU:
+        case opcode::BLEU:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool block_cache::ends_block(const opcode op) {
+    switch (op) {
+        case opcode::RET:
+        case opcode::J:
+        case opcode::CALL:
+        case opcode::TAIL:
+        case opcode::JAL:
+        case opcode::JR:
+        case opcode::JALR:
+        case opcode::BEQ:
+        case opcode::BNE:
+        case opcode::BLT:
+        case opcode::BGE:
+        case opcode::BLTU:
+        case opcode::BGEU:
+        case opcode::BGT:
+        case opcode::BLE:
+        case opcode::BGTU:
+        case opcode::BLEU:
+        case opcode::ECALL:
+        case opcode::EBREAK:
+        case opcode::UNIMP:
+        case opcode::LUI_ADDI:
+        case opcode::SLT_BNEZ:
+        case opcode::AUIPC_JALR:
+        case opcode::ADDI_BNE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+basic_block block_cache::build(const uint32_t pc, const uint32_t index) const {
+    const auto &code = _prog->code;
+    uint32_t end = index;
+    while (end < code.size() && !ends_block(code[end].op)) ++end;
+
+    // the terminator belongs to the block, running off the program does not
+    const uint32_t length = (end < code.size() ? end + 1 : end) - index;
+    const uint32_t last_pc = pc + (length - 1) * 4;
+    const instruction &last = code[index + length - 1];
+
+    basic_block block{pc, index, length};
+    block.fallthrough_pc = last_pc + 4;
+    block.taken_pc = is_direct(last.op) ? last_pc + last.imm : block.fallthrough_pc;
+
+    // superinstructions cover the next slot too, their branch is relative to it
+    if (last.op >= opcode::LUI_ADDI) {
+        const instruction &second = code[index + length];
+        block.fallthrough_pc = last_pc + 8;
+        block.taken_pc = block.fallthrough_pc;
+        if (last.op == opcode::SLT_BNEZ || last.op == opcode::ADDI_BNE)
+            block.taken_pc = last_pc + 4 + second.imm;
+        else if (last.op == opcode::AUIPC_JALR)
+            block.taken_pc = (last_pc + (static_cast<uint32_t>(last.imm) << 12) + second.imm) & ~1u;
+    }
+    return block;
+}
+
+bool block_cache::bind(const program &prog) {
+    if (_prog == &prog && _generation == prog.generation) return false;
+
+    clear();
+    _prog = &prog;
+    _generation = prog.generation;
+    return true;
+}
+
+void block_cache::clear() {
+    _blocks.clear();
+    _prog = nullptr;
+    _generation = 0;
+}
+
+basic_block *block_cache::lookup(const uint32_t pc) {
+    if (const auto it = _blocks.find(pc); it != _blocks.end()) return &it->second;
+
+    const uint32_t offset = pc - _prog->base;
+    const size_t index = offset >> 2;
+    if (index >= _prog->code.size() || (offset & 3)) return nullptr;
+
+    return &_blocks.emplace(pc, build(pc, index)).first->second;
+}
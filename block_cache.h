@@ -0,0 +1,71 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "instruction.h"
+
+// host code for the leading instructions of a block, takes cpu::registers.data()
+using native_block = void (*)(void* registers);
+
+// straight-line run of instructions, only the last one may leave the block
+struct basic_block {
+    uint32_t    start;      // guest address of the first instruction
+    uint32_t    index;      // of the first instruction in program::code
+    uint32_t    length;
+    uint64_t    executions = 0;
+
+    // successors are patched in the first time an edge is taken. indirect jumps
+    // have no static target, taken_pc is then the fall-through address
+    uint32_t        fallthrough_pc = 0;
+    uint32_t        taken_pc = 0;
+    basic_block*    fallthrough = nullptr;
+    basic_block*    taken = nullptr;
+
+    // filled in by the jit once the block is hot, the rest of the block is interpreted
+    native_block    native = nullptr;
+    uint32_t        native_length = 0;
+    bool            compiled = false;
+};
+
+class block_cache {
+    // node based, pointers to blocks and the chains between them stay valid until clear()
+    std::unordered_map<uint32_t, basic_block> _blocks;
+    const program*      _prog = nullptr;
+    uint64_t            _generation = 0;
+
+    [[nodiscard]] static bool ends_block(opcode op);
+    [[nodiscard]] static bool is_direct(opcode op);
+    [[nodiscard]] basic_block build(uint32_t pc, uint32_t index) const;
+public:
+    // drops every block and chain when prog is not the program the cache was built for,
+    // or it is but its generation changed since. returns true when it did
+    bool                bind(const program& prog);
+    void                clear();
+
+    // nullptr when pc is outside of the program or not on an instruction
+    [[nodiscard]] basic_block* lookup(uint32_t pc);
+
+    // successor of from once control is at pc, follows the chain when it can
+    [[nodiscard]] basic_block* next(basic_block& from, const uint32_t pc) {
+        if (pc == from.fallthrough_pc) {
+            if (!from.fallthrough) from.fallthrough = lookup(pc);
+            return from.fallthrough;
+        }
+
+        if (pc == from.taken_pc) {
+            if (!from.taken) from.taken = lookup(pc);
+            return from.taken;
+        }
+
+        return lookup(pc);
+    }
+    [[nodiscard]] size_t size() const { return _blocks.size(); }
+};
+
+#endif //BLOCK_CACHE_H
@@ -2,36 +2,32 @@
 // Created by Antonie Gabriel Belu on 12.12.2025.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <climits>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "cpu.h"
 
-cpu::cpu() : registers{{{0, "zero"}, {0, "ra"}, {0, "sp"}, {0, "gp"}, {0, "tp"}, {0, "t0"}, {0, "t1"}, {0, "t2"}, {0, "s0/fp"}, {0, "s1"}, {0, "a0"}, {0, "a1"}, {0, "a2"}, {0, "a3"}, {0, "a4"}, {0, "a5"}, {0, "a6"}, {0, "a7"}, {0, "s2"}, {0, "s3"}, {0, "s4"}, {0, "s5"}, {0, "s6"}, {0, "s7"}, {0, "s8"}, {0, "s9"}, {0, "s10"}, {0, "s11"}, {0, "t3"}, {0, "t4"}, {0, "t5"}, {0, "t6"}}} {
-    stack.reserve(256);
-}
-uint32_t cpu::stoui_offset(const std::string &s, size_t offset) {
-    if (s.empty()) throw std::invalid_argument("Empty string");
-
-    if (offset >= s.size()) throw std::invalid_argument("Offset out of range");
-
-    const bool zero_first = s[offset] == '0';
-    const size_t len = s.size();
-    if (len - offset == 1 && zero_first) return 0;
-
-    if (zero_first) throw std::invalid_argument("Invalid number format");
-
-    unsigned int num = 0;
-    for (; offset < len; ++offset) {
-        const char c = s[offset];
-        if (c < '0' || c > '9') throw std::invalid_argument("Invalid character");
+// only print_registers needs these, they stay off the hot state
+static constexpr std::array<std::string_view, 32> ABI_NAMES = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0/fp", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
 
-        num = num * 10 + (c - '0');
-    }
-
-    return num;
+cpu::cpu(const uint64_t memory_size, const memory_model model) : _model(model), memory(model == memory_model::FLAT ? memory_size : 0) {
+    // the stack grows down from the top of guest memory
+    if (model == memory_model::PAGED)
+        registers[SP] = PAGED_STACK_TOP;
+    else
+        registers[SP] = static_cast<uint32_t>(memory.size() & ~0xfULL);
 }
 uint32_t cpu::get_bits_from_range(const uint32_t num, const size_t start, const size_t end) {
     if (start > end)
@@ -43,764 +39,1054 @@ uint32_t cpu::get_bits_from_range(const uint32_t num, const size_t start, const
     const uint64_t mask = (1ULL << (end-start+1)) - 1;
     return (num >> start) & static_cast<uint32_t>(mask);
 }
-size_t cpu::get_register_index(const std::string &reg_name) {
-    if (reg_name.empty()) throw std::invalid_argument("Empty register");
-
-    if (reg_name.size() == 1 || reg_name.size() > 4) throw std::invalid_argument("Invalid register name: " + reg_name);
-
-    switch (reg_name[0]) {
-        case 'x': {
-            const auto i = stoui_offset(reg_name, 1);
-            if (i > 31) throw std::invalid_argument("Bad register index: " + reg_name);
-
-            return i;
-        }
-
-        case 'z': {
-            if (reg_name != "zero") throw std::invalid_argument("Invalid register: " + reg_name);
-
-            return ZERO;
-        }
-
-        case 'r': {
-            if (reg_name != "ra") throw std::invalid_argument("Invalid register: " + reg_name);
-
-            return RA;
-        }
-
-        case 'g': {
-            if (reg_name != "gp") throw std::invalid_argument("Invalid register: " + reg_name);
-
-            return GP;
-        }
-
-        case 't': {
-            if (reg_name == "tp") return TP;
-
-            const auto i = stoui_offset(reg_name, 1);
-            if (i > 6) throw std::invalid_argument("Bad register index: " + reg_name);
-
-            if (i <= 2) return T0 + i;
-
-            return T3 + (i - 3);
-        }
-
-        case 's': {
-            if (reg_name == "sp") return SP;
-
-            const auto i = stoui_offset(reg_name, 1);
-            if (i > 11) throw std::invalid_argument("Bad register index: " + reg_name);
-
-            if (i <= 1) return S0 + i;
-
-            return S2 + (i - 2);
-        }
-
-        case 'a': {
-            const auto i = stoui_offset(reg_name, 1);
-            if (i > 7) throw std::invalid_argument("Bad register index: " + reg_name);
-
-            return A0 + i;
-        }
-
-        case 'f': {
-            if (reg_name != "fp") throw std::invalid_argument("Invalid register: " + reg_name);
+void cpu::print_registers(const bool hex) const {
+    std::cout << "------------- Registers -------------\n";
+    for (size_t i = 0; i < ABI_NAMES.size(); ++i) {
+        const auto value = static_cast<int32_t>(registers[i]);
+        std::cout << std::left << std::setw(6) << std::setfill(' ') << std::dec << ABI_NAMES[i]  << "| x" << i << std::left << std::setw(3) << std::setfill(' ') << std::dec<< " = " << std::right << (hex ? std::setw(8) : std::setw(0)) << std::setfill('0') << (hex ? std::hex : std::dec) << value << "\n";
+    }
 
-            return FP;
+    std::cout << std::endl;
+}
+void cpu::map_segments(const program &prog) {
+    for (const auto &seg : prog.segments) {
+        if (_model == memory_model::PAGED) {
+            paged.write(seg.address, seg.bytes.data(), seg.bytes.size());
+            paged.clear(seg.address + seg.bytes.size(), seg.size - seg.bytes.size());
+        } else {
+            memory.write(seg.address, seg.bytes.data(), seg.bytes.size());
+            memory.clear(seg.address + seg.bytes.size(), seg.size - seg.bytes.size());
         }
-
-        default:
-            throw std::invalid_argument("Register not implemented yet, did you discover a new one?: " + reg_name);
     }
 }
-int16_t cpu::get_imm12(const std::string &s) {
-    if (s.empty()) throw std::invalid_argument("Empty imm12");
-
-    int imm12 = 0;
-    try {
-        imm12 = std::stoi(s);
-    } catch (const std::exception &) {
-        throw std::invalid_argument("Invalid imm12: " + s);
-    }
-
-    // signed 12 bits integer
-    if (imm12 < -2048 || imm12 > 2047) throw std::invalid_argument("Invalid imm12 range: " + s);
-
-    return static_cast<int16_t>(imm12);
+uint32_t cpu::get_address(const instruction &in) const {
+    return get_register_value_unsigned(in.rs1) + in.imm;
 }
-int32_t cpu::get_imm20(const std::string &s) {
-    if (s.empty()) throw std::invalid_argument("Empty imm20");
-
-    int imm20 = 0;
-    try {
-        imm20 = std::stoi(s);
-    } catch (const std::exception &) {
-        throw std::invalid_argument("Invalid imm20: " + s);
-    }
-
-    // signed 20bits integer
-    if (imm20 < -524288 || imm20 > 524287) throw std::invalid_argument("Invalid imm20 range: " + s);
-
-    return imm20;
+void cpu::jump(const uint32_t target) {
+    // the lowest bit is ignored like jalr does, anything else misaligned is caught by execute
+    _next_pc = target & ~1u;
 }
-void cpu::print_registers(const bool hex) const {
-    std::cout << "------------- Registers -------------\n";
-    size_t i = 0;
-    for (const auto &r : registers) {
-        std::cout << std::left << std::setw(6) << std::setfill(' ') << std::dec << r.name  << "| x" << i << std::left << std::setw(3) << std::setfill(' ') << std::dec<< " = " << std::right << (hex ? std::setw(8) : std::setw(0)) << std::setfill('0') << (hex ? std::hex : std::dec) << r.value << "\n";
-        ++i;
-    }
 
-    std::cout << std::endl;
+template <>
+void cpu::exec<opcode::RET>(const instruction &) {
+    jump(get_register_value_unsigned(RA));
 }
-void cpu::write_register(const size_t idx, const int32_t value) {
-    if (idx == 0) return;
 
-    if (idx > 31) throw std::invalid_argument("Invalid register index: " + std::to_string(idx));
-
-    registers[idx].value = value;
+template <>
+void cpu::exec<opcode::NOP>(const instruction &) {
 }
-int32_t cpu::get_register_value(const size_t idx) const {
-    if (idx == 0) return registers[idx].value;
-
-    if (idx > 31) throw std::invalid_argument("Invalid register index: " + std::to_string(idx));
 
-    return registers[idx].value;
+template <>
+void cpu::exec<opcode::ECALL>(const instruction &) {
+    if (!_sys.call(*this)) raise(status::EXITED);
 }
-uint32_t cpu::get_register_value_unsigned(const size_t idx) const {
-    if (idx == 0) return static_cast<uint32_t>(registers[idx].value);
 
-    if (idx > 31) throw std::invalid_argument("Invalid register index: " + std::to_string(idx));
-
-    return static_cast<uint32_t>(registers[idx].value);
+template <>
+void cpu::exec<opcode::EBREAK>(const instruction &) {
+    raise(status::BREAKPOINT);
 }
-void cpu::prepare_instruction(std::string &inst) {
-    for (char &c : inst)
-        if (c == ',') c = ' ';
-
-    size_t i = 0;
-    const size_t len = inst.size();
-    while (i < len && inst[i] == ' ') ++i;
-    inst.erase(0, i);
 
-    if (inst.front() == '#')
-        inst.clear();
+template <>
+void cpu::exec<opcode::J>(const instruction &in) {
+    _next_pc = pc + in.imm;
 }
-bool cpu::is_comment(const std::string &s) const {
-    if (s.empty())
-        return false;
-
-    for (const auto &c : _valid_com_chars)
-        if (s.front() == c) return true;
 
-    return false;
+template <>
+void cpu::exec<opcode::CALL>(const instruction &in) {
+    write_register(RA, static_cast<int32_t>(pc + 4));
+    _next_pc = pc + in.imm;
 }
 
-void cpu::instr_ret(bool args_ok) {
+template <>
+void cpu::exec<opcode::TAIL>(const instruction &in) {
+    _next_pc = pc + in.imm;
 }
 
-void cpu::instr_nop(const bool args_ok) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: nop");
+template <>
+void cpu::exec<opcode::LB>(const instruction &in) {
+    uint8_t value;
+    if (load(get_address(in), value)) write_register(in.rd, static_cast<int8_t>(value));
 }
 
-void cpu::instr_ecall(bool args_ok) {
+template <>
+void cpu::exec<opcode::LH>(const instruction &in) {
+    uint16_t value;
+    if (load(get_address(in), value)) write_register(in.rd, static_cast<int16_t>(value));
 }
 
-void cpu::instr_ebreak(bool args_ok) {
+template <>
+void cpu::exec<opcode::LW>(const instruction &in) {
+    uint32_t value;
+    if (load(get_address(in), value)) write_register(in.rd, static_cast<int32_t>(value));
 }
 
-void cpu::instr_j(bool args_ok, const std::string &arg1) {
+template <>
+void cpu::exec<opcode::LBU>(const instruction &in) {
+    uint8_t value;
+    if (load(get_address(in), value)) write_register(in.rd, value);
 }
 
-void cpu::instr_call(bool args_ok, const std::string &arg1) {
+template <>
+void cpu::exec<opcode::LHU>(const instruction &in) {
+    uint16_t value;
+    if (load(get_address(in), value)) write_register(in.rd, value);
 }
 
-void cpu::instr_tail(bool args_ok, const std::string &arg1) {
+template <>
+void cpu::exec<opcode::SB>(const instruction &in) {
+    store<uint8_t>(get_address(in), get_register_value_unsigned(in.rs2));
 }
 
-void cpu::instr_lb(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::SH>(const instruction &in) {
+    store<uint16_t>(get_address(in), get_register_value_unsigned(in.rs2));
 }
 
-void cpu::instr_lh(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::SW>(const instruction &in) {
+    store<uint32_t>(get_address(in), get_register_value_unsigned(in.rs2));
 }
 
-void cpu::instr_lw(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::LI>(const instruction &in) {
+    write_register(in.rd, in.imm);
 }
 
-void cpu::instr_lbu(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::LUI>(const instruction &in) {
+    write_register(in.rd, in.imm << 12);
 }
 
-void cpu::instr_lhu(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::AUIPC>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(pc + (static_cast<uint32_t>(in.imm) << 12)));
 }
 
-void cpu::instr_sb(bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sb");
-
-
+template <>
+void cpu::exec<opcode::MV>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1));
 }
 
-void cpu::instr_sh(bool args_ok, const std::string &arg1, const std::string &arg2) {
+// rv32 has no upper half to sign extend into, sext.w is mv
+template <>
+void cpu::exec<opcode::SEXT_W>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1));
 }
 
-void cpu::instr_sw(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::NEG>(const instruction &in) {
+    write_register(in.rd, -get_register_value(in.rs1));
 }
 
-void cpu::instr_li(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: li");
-
-    instr_addi(true, arg1, "x0", arg2);
+template <>
+void cpu::exec<opcode::NEGW>(const instruction &in) {
+    write_register(in.rd, -get_register_value(in.rs1));
 }
 
-void cpu::instr_lui(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: lui");
-
-    const size_t rd = get_register_index(arg1);
-    const int32_t imm20 = get_imm20(arg2);
-    write_register(rd, imm20 << 12);
+template <>
+void cpu::exec<opcode::SEQZ>(const instruction &in) {
+    write_register(in.rd, get_register_value_unsigned(in.rs1) < 1);
 }
 
-void cpu::instr_auipc(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::SNEZ>(const instruction &in) {
+    write_register(in.rd, 0 < get_register_value_unsigned(in.rs1));
 }
 
-void cpu::instr_mv(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: mv");
-
-    instr_addi(true, arg1, arg2, "0");
+template <>
+void cpu::exec<opcode::NOT>(const instruction &in) {
+    write_register(in.rd, ~get_register_value(in.rs1));
 }
 
-void cpu::instr_sextw(bool args_ok, const std::string &arg1, const std::string &arg2) {}
-
-void cpu::instr_neg(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: neg");
-
-    instr_sub(true, arg1, "x0", arg2);
+template <>
+void cpu::exec<opcode::JAL>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(pc + 4));
+    _next_pc = pc + in.imm;
 }
 
-void cpu::instr_negw(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::JR>(const instruction &in) {
+    jump(get_register_value_unsigned(in.rs1));
 }
 
-void cpu::instr_seqz(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: seqz");
-
-    instr_sltiu(true, arg1, arg2, "1");
+template <>
+void cpu::exec<opcode::SLTZ>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) < 0);
 }
 
-void cpu::instr_snez(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: snez");
-
-    instr_sltu(true, arg1, "x0", arg2);
+template <>
+void cpu::exec<opcode::SGTZ>(const instruction &in) {
+    write_register(in.rd, 0 < get_register_value(in.rs1));
 }
 
-void cpu::instr_not(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: not");
-
-    instr_xori(true, arg1, arg2, "-1");
+template <>
+void cpu::exec<opcode::ADD>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) + get_register_value(in.rs2));
 }
 
-void cpu::instr_jal(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::ADDI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) + in.imm);
 }
 
-void cpu::instr_jr(bool args_ok, const std::string &arg1, const std::string &arg2) {
+template <>
+void cpu::exec<opcode::XOR>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) ^ get_register_value(in.rs2));
 }
 
-void cpu::instr_sltz(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sltz");
-
-    instr_slt(true, arg1, arg2, "x0");
+template <>
+void cpu::exec<opcode::XORI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) ^ in.imm);
 }
 
-void cpu::instr_sgtz(const bool args_ok, const std::string &arg1, const std::string &arg2) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sgtz");
-
-    instr_slt(true, arg1, "x0", arg2);
+template <>
+void cpu::exec<opcode::OR>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) | get_register_value(in.rs2));
 }
 
-void cpu::instr_add(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: add");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) + get_register_value(rs2));
+template <>
+void cpu::exec<opcode::ORI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) | in.imm);
 }
 
-void cpu::instr_addi(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: addi");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) + imm12);
+template <>
+void cpu::exec<opcode::AND>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) & get_register_value(in.rs2));
 }
 
-void cpu::instr_xor(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: xor");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) ^ get_register_value(rs2));
+template <>
+void cpu::exec<opcode::ANDI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) & in.imm);
 }
 
-void cpu::instr_xori(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: xori");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) ^ imm12);
+template <>
+void cpu::exec<opcode::SLL>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) << (get_register_value_unsigned(in.rs2) & 0x1f)));
 }
 
-void cpu::instr_or(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: or");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) | get_register_value(rs2));
+template <>
+void cpu::exec<opcode::SLLI>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) << in.imm));
 }
 
-void cpu::instr_ori(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: ori");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) | imm12);
+template <>
+void cpu::exec<opcode::SRLI>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) >> in.imm));
 }
 
-void cpu::instr_and(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: and");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) & get_register_value(rs2));
+template <>
+void cpu::exec<opcode::SRL>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) >> (get_register_value_unsigned(in.rs2) & 0x1f)));
 }
 
-void cpu::instr_andi(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: andi");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) & imm12);
+template <>
+void cpu::exec<opcode::SRAI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) >> in.imm);
 }
 
-void cpu::instr_sll(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sll");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) << get_bits_from_range(get_register_value_unsigned(rs2), 0, 4)));
+template <>
+void cpu::exec<opcode::SRA>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) >> (get_register_value_unsigned(in.rs2) & 0x1f));
 }
 
-void cpu::instr_slli(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: slli");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) << get_bits_from_range(imm12, 0, 4)));
+template <>
+void cpu::exec<opcode::SUB>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) - get_register_value(in.rs2));
 }
 
-void cpu::instr_srli(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: srli");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) >> get_bits_from_range(imm12, 0, 4)));
+template <>
+void cpu::exec<opcode::SUBI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) - in.imm);
 }
 
-void cpu::instr_srl(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: srl");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) >> get_bits_from_range(get_register_value_unsigned(rs2), 0, 4)));
+template <>
+void cpu::exec<opcode::SLT>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) < get_register_value(in.rs2));
 }
 
-void cpu::instr_srai(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: srai");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) >> get_bits_from_range(imm12, 0, 4));
+template <>
+void cpu::exec<opcode::SLTI>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) < in.imm);
 }
 
-void cpu::instr_sra(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sra");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-
-    write_register(rd, get_register_value(rs1) >> get_bits_from_range(get_register_value(rs2), 0, 4));
+template <>
+void cpu::exec<opcode::SLTU>(const instruction &in) {
+    write_register(in.rd, get_register_value_unsigned(in.rs1) < get_register_value_unsigned(in.rs2));
 }
 
-void cpu::instr_sub(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sub");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) - get_register_value(rs2));
+template <>
+void cpu::exec<opcode::SLTIU>(const instruction &in) {
+    // the immediate is sign extended first, then compared as unsigned
+    write_register(in.rd, get_register_value_unsigned(in.rs1) < static_cast<uint32_t>(in.imm));
 }
 
-void cpu::instr_slt(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: slt");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) < get_register_value(rs2));
+template <>
+void cpu::exec<opcode::BEQ>(const instruction &in) {
+    if (get_register_value(in.rs1) == get_register_value(in.rs2)) _next_pc = pc + in.imm;
 }
 
-void cpu::instr_slti(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: slt");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value(rs1) < imm12);
+template <>
+void cpu::exec<opcode::BNE>(const instruction &in) {
+    if (get_register_value(in.rs1) != get_register_value(in.rs2)) _next_pc = pc + in.imm;
 }
 
-void cpu::instr_sltu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sltu");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value_unsigned(rs1) < get_register_value_unsigned(rs2));
+template <>
+void cpu::exec<opcode::BLT>(const instruction &in) {
+    if (get_register_value(in.rs1) < get_register_value(in.rs2)) _next_pc = pc + in.imm;
 }
-void cpu::instr_sltiu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: sltu");
 
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const int16_t imm12 = get_imm12(arg3);
-    write_register(rd, get_register_value_unsigned(rs1) < static_cast<uint16_t>(imm12));
+template <>
+void cpu::exec<opcode::BGE>(const instruction &in) {
+    if (get_register_value(in.rs1) >= get_register_value(in.rs2)) _next_pc = pc + in.imm;
 }
 
-void cpu::instr_beq(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::BLTU>(const instruction &in) {
+    if (get_register_value_unsigned(in.rs1) < get_register_value_unsigned(in.rs2)) _next_pc = pc + in.imm;
 }
 
-void cpu::instr_bne(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::BGEU>(const instruction &in) {
+    if (get_register_value_unsigned(in.rs1) >= get_register_value_unsigned(in.rs2)) _next_pc = pc + in.imm;
 }
 
-void cpu::instr_blt(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::JALR>(const instruction &in) {
+    // read rs1 before rd is written, they can be the same register
+    const uint32_t target = get_register_value_unsigned(in.rs1) + in.imm;
+    write_register(in.rd, static_cast<int32_t>(pc + 4));
+    jump(target);
 }
 
-void cpu::instr_bge(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::MUL>(const instruction &in) {
+    write_register(in.rd, get_register_value(in.rs1) * get_register_value(in.rs2));
 }
 
-void cpu::instr_bltu(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::MULH>(const instruction &in) {
+    const int64_t result = static_cast<int64_t>(get_register_value(in.rs1)) * static_cast<int64_t>(get_register_value(in.rs2));
+    write_register(in.rd, static_cast<int32_t>(result >> 32));
 }
 
-void cpu::instr_bgeu(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::MULSU>(const instruction &in) {
+    // rs2 is zero extended, only rs1 carries a sign
+    const int64_t result = static_cast<int64_t>(get_register_value(in.rs1)) * static_cast<int64_t>(get_register_value_unsigned(in.rs2));
+    write_register(in.rd, static_cast<int32_t>(result >> 32));
 }
 
-void cpu::instr_jalr(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+template <>
+void cpu::exec<opcode::MULU>(const instruction &in) {
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) * get_register_value_unsigned(in.rs2)));
 }
 
-void cpu::instr_mul(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: mul");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, get_register_value(rs1) * get_register_value(rs2));
+template <>
+void cpu::exec<opcode::MULHU>(const instruction &in) {
+    const uint64_t result = static_cast<uint64_t>(get_register_value_unsigned(in.rs1)) * get_register_value_unsigned(in.rs2);
+    write_register(in.rd, static_cast<int32_t>(result >> 32));
 }
 
-void cpu::instr_mulh(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: mulh");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const int64_t result = static_cast<int64_t>(get_register_value(rs1)) * static_cast<int64_t>(get_register_value(rs2));
-    write_register(rd, static_cast<int32_t>(result >> 32));
-}
+template <>
+void cpu::exec<opcode::DIV>(const instruction &in) {
+    const int32_t rs2_value = get_register_value(in.rs2);
+    if (rs2_value == 0) {
+        write_register(in.rd, -1);
+        return;
+    }
 
-void cpu::instr_mulsu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: mulsu");
+    const int32_t rs1_value = get_register_value(in.rs1);
+    if (rs1_value == INT_MIN && rs2_value == -1) {
+        write_register(in.rd, INT_MIN);
+        return;
+    }
 
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const int64_t result = static_cast<int64_t>(static_cast<int64_t>(get_register_value(rs1)) * static_cast<uint64_t>(get_register_value(rs2)));
-    write_register(rd, static_cast<int32_t>(result >> 32));
+    write_register(in.rd, rs1_value / rs2_value);
 }
 
-void cpu::instr_mulu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: mulu");
+template <>
+void cpu::exec<opcode::DIVU>(const instruction &in) {
+    const uint32_t rs2_value = get_register_value_unsigned(in.rs2);
+    if (rs2_value == 0) {
+        write_register(in.rd, static_cast<int32_t>(-1u));
+        return;
+    }
 
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) * get_register_value_unsigned(rs2)));
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) / rs2_value));
 }
 
-void cpu::instr_div(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: div");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const int32_t rs2_value = get_register_value(rs2);
+template <>
+void cpu::exec<opcode::REM>(const instruction &in) {
+    const int32_t rs2_value = get_register_value(in.rs2);
     if (rs2_value == 0) {
-        write_register(rd, -1);
+        write_register(in.rd, get_register_value(in.rs1));
         return;
     }
 
-    const int32_t rs1_value = get_register_value(rs1);
+    const int32_t rs1_value = get_register_value(in.rs1);
     if (rs1_value == INT_MIN && rs2_value == -1) {
-        write_register(rd, INT_MIN);
+        write_register(in.rd, 0);
         return;
     }
 
-    write_register(rd, rs1_value / rs2_value);
+    write_register(in.rd, rs1_value % rs2_value);
 }
 
-void cpu::instr_divu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: divu");
-
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const uint32_t rs2_value = get_register_value_unsigned(rs2);
+template <>
+void cpu::exec<opcode::REMU>(const instruction &in) {
+    const uint32_t rs2_value = get_register_value_unsigned(in.rs2);
     if (rs2_value == 0) {
-        write_register(rd, static_cast<int32_t>(-1u));
+        write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1)));
         return;
     }
 
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) / rs2_value));
+    write_register(in.rd, static_cast<int32_t>(get_register_value_unsigned(in.rs1) % rs2_value));
 }
 
-void cpu::instr_rem(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: rem");
+template <>
+void cpu::exec<opcode::BGT>(const instruction &in) {
+    if (get_register_value(in.rs1) > get_register_value(in.rs2)) _next_pc = pc + in.imm;
+}
 
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const int32_t rs2_value = get_register_value(rs2);
-    if (rs2_value == 0) {
-        write_register(rd, get_register_value(rs1));
+template <>
+void cpu::exec<opcode::BLE>(const instruction &in) {
+    if (get_register_value(in.rs1) <= get_register_value(in.rs2)) _next_pc = pc + in.imm;
+}
+
+template <>
+void cpu::exec<opcode::BGTU>(const instruction &in) {
+    if (get_register_value_unsigned(in.rs1) > get_register_value_unsigned(in.rs2)) _next_pc = pc + in.imm;
+}
+
+template <>
+void cpu::exec<opcode::BLEU>(const instruction &in) {
+    if (get_register_value_unsigned(in.rs1) <= get_register_value_unsigned(in.rs2)) _next_pc = pc + in.imm;
+}
+
+template <>
+void cpu::exec<opcode::UNIMP>(const instruction &) {
+    raise(status::ILLEGAL_INSTRUCTION);
+}
+
+// flat memory is the one harts share, every access to it here is a seq_cst host atomic.
+// the paged model is never shared and gets plain accesses
+template <>
+void cpu::exec<opcode::LR_W>(const instruction &in) {
+    const uint32_t addr = get_register_value_unsigned(in.rs1);
+    _amo_address = addr;
+    if (_model == memory_model::PAGED) {
+        if (addr & 3) {
+            raise(status::LOAD_FAULT, addr, 4);
+            return;
+        }
+
+        const uint32_t value = paged.load<uint32_t>(addr);
+        _reservation = {addr, to_little_endian(value), true};
+        write_register(in.rd, static_cast<int32_t>(value));
         return;
     }
 
-    const int32_t rs1_value = get_register_value(rs1);
-    if (rs1_value == INT_MIN && rs2_value == -1) {
-        write_register(rd, 0);
+    uint32_t *word = memory.word(addr);
+    if (!word) {
+        raise(status::LOAD_FAULT, addr, 4);
         return;
     }
 
-    write_register(rd, rs1_value % rs2_value);
+    const uint32_t raw = std::atomic_ref(*word).load();
+    _reservation = {addr, raw, true};
+    write_register(in.rd, static_cast<int32_t>(to_little_endian(raw)));
 }
 
-void cpu::instr_remu(const bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-    if (!args_ok)
-        throw std::invalid_argument("Number of args is invalid: remu");
+template <>
+void cpu::exec<opcode::SC_W>(const instruction &in) {
+    const uint32_t addr = get_register_value_unsigned(in.rs1);
+    const uint32_t desired = to_little_endian(get_register_value_unsigned(in.rs2));
+    _amo_address = addr;
 
-    const size_t rd = get_register_index(arg1);
-    const size_t rs1 = get_register_index(arg2);
-    const size_t rs2 = get_register_index(arg3);
-    const uint32_t rs2_value = get_register_value_unsigned(rs2);
-    if (rs2_value == 0) {
-        write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1)));
+    uint32_t *word = _model == memory_model::FLAT ? memory.word(addr) : nullptr;
+    if ((addr & 3) || (_model == memory_model::FLAT && !word)) {
+        raise(status::STORE_FAULT, addr, 4);
         return;
     }
 
-    write_register(rd, static_cast<int32_t>(get_register_value_unsigned(rs1) % rs2_value));
-}
+    const reservation held = std::exchange(_reservation, {});
+    bool stored = held.valid && held.address == addr;
+    if (stored && _model == memory_model::PAGED) {
+        stored = to_little_endian(paged.load<uint32_t>(addr)) == held.value;
+        if (stored) paged.store<uint32_t>(addr, to_little_endian(desired));
+    } else if (stored) {
+        uint32_t expected = held.value;
+        stored = std::atomic_ref(*word).compare_exchange_strong(expected, desired);
+    }
+    write_register(in.rd, stored ? 0 : 1);
+}
+
+template <>
+void cpu::exec<opcode::FENCE>(const instruction &) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template <>
+void cpu::exec<opcode::CSRR>(const instruction &in) {
+    // mhartid is the only csr there is
+    if (in.imm == CSR_MHARTID)
+        write_register(in.rd, static_cast<int32_t>(hart_id));
+    else
+        raise(status::ILLEGAL_INSTRUCTION);
+}
+
+static uint32_t amo_apply(const amo_kind kind, const uint32_t old, const uint32_t operand) {
+    switch (kind) {
+        case amo_kind::SWAP: return operand;
+        case amo_kind::ADD:  return old + operand;
+        case amo_kind::XOR:  return old ^ operand;
+        case amo_kind::AND:  return old & operand;
+        case amo_kind::OR:   return old | operand;
+        case amo_kind::MIN:  return static_cast<int32_t>(old) < static_cast<int32_t>(operand) ? old : operand;
+        case amo_kind::MAX:  return static_cast<int32_t>(old) > static_cast<int32_t>(operand) ? old : operand;
+        case amo_kind::MINU: return std::min(old, operand);
+        case amo_kind::MAXU: return std::max(old, operand);
+    }
+    return old;
+}
+
+template <amo_kind K>
+void cpu::amo(const instruction &in) {
+    const uint32_t addr = get_register_value_unsigned(in.rs1);
+    const uint32_t operand = get_register_value_unsigned(in.rs2);
+    _amo_address = addr;
+    if (_model == memory_model::PAGED) {
+        if (addr & 3) {
+            raise(status::STORE_FAULT, addr, 4);
+            return;
+        }
 
-void cpu::instr_bgt(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
-}
+        const uint32_t old = paged.load<uint32_t>(addr);
+        paged.store<uint32_t>(addr, amo_apply(K, old, operand));
+        write_register(in.rd, static_cast<int32_t>(old));
+        return;
+    }
+
+    uint32_t *word = memory.word(addr);
+    if (!word) {
+        raise(status::STORE_FAULT, addr, 4);
+        return;
+    }
+
+    // xchg and lock xadd on x86, ldaddal and friends on arm. min and max have no
+    // fetch op and retry a compare exchange, so does everything on big endian hosts
+    std::atomic_ref ref(*word);
+    uint32_t old;
+    if constexpr (std::endian::native == std::endian::little && K == amo_kind::SWAP)
+        old = ref.exchange(operand);
+    else if constexpr (std::endian::native == std::endian::little && K == amo_kind::ADD)
+        old = ref.fetch_add(operand);
+    else if constexpr (std::endian::native == std::endian::little && K == amo_kind::XOR)
+        old = ref.fetch_xor(operand);
+    else if constexpr (std::endian::native == std::endian::little && K == amo_kind::AND)
+        old = ref.fetch_and(operand);
+    else if constexpr (std::endian::native == std::endian::little && K == amo_kind::OR)
+        old = ref.fetch_or(operand);
+    else {
+        uint32_t raw = ref.load();
+        while (!ref.compare_exchange_weak(raw, to_little_endian(amo_apply(K, to_little_endian(raw), operand)))) {}
+        old = to_little_endian(raw);
+    }
+    write_register(in.rd, static_cast<int32_t>(old));
+}
+
+template <> void cpu::exec<opcode::AMOSWAP_W>(const instruction &in) { amo<amo_kind::SWAP>(in); }
+template <> void cpu::exec<opcode::AMOADD_W>(const instruction &in)  { amo<amo_kind::ADD>(in); }
+template <> void cpu::exec<opcode::AMOXOR_W>(const instruction &in)  { amo<amo_kind::XOR>(in); }
+template <> void cpu::exec<opcode::AMOAND_W>(const instruction &in)  { amo<amo_kind::AND>(in); }
+template <> void cpu::exec<opcode::AMOOR_W>(const instruction &in)   { amo<amo_kind::OR>(in); }
+template <> void cpu::exec<opcode::AMOMIN_W>(const instruction &in)  { amo<amo_kind::MIN>(in); }
+template <> void cpu::exec<opcode::AMOMAX_W>(const instruction &in)  { amo<amo_kind::MAX>(in); }
+template <> void cpu::exec<opcode::AMOMINU_W>(const instruction &in) { amo<amo_kind::MINU>(in); }
+template <> void cpu::exec<opcode::AMOMAXU_W>(const instruction &in) { amo<amo_kind::MAXU>(in); }
+
+template <>
+void cpu::exec<opcode::LUI_ADDI>(const instruction &in) {
+    const instruction &addi = (&in)[1];
+    write_register(in.rd, (in.imm << 12) + addi.imm);
+    _next_pc = pc + 8;
+    ++fused[0];
+    ++retired; // the second half, the engine counts the slot
+}
+
+template <>
+void cpu::exec<opcode::SLT_BNEZ>(const instruction &in) {
+    const instruction &bnez = (&in)[1];
+    const bool less = get_register_value(in.rs1) < get_register_value(in.rs2);
+    write_register(in.rd, less);
+    _next_pc = less ? pc + 4 + bnez.imm : pc + 8;
+    ++fused[1];
+    ++retired;
+}
+
+template <>
+void cpu::exec<opcode::AUIPC_JALR>(const instruction &in) {
+    const instruction &jalr = (&in)[1];
+    const uint32_t base = pc + (static_cast<uint32_t>(in.imm) << 12);
+    write_register(in.rd, static_cast<int32_t>(base));
+    write_register(jalr.rd, static_cast<int32_t>(pc + 8));
+    jump(base + jalr.imm);
+    ++fused[2];
+    ++retired;
+}
+
+template <>
+void cpu::exec<opcode::ADDI_BNE>(const instruction &in) {
+    const instruction &bne = (&in)[1];
+    write_register(in.rd, get_register_value(in.rs1) + in.imm);
+    _next_pc = get_register_value(bne.rs1) != get_register_value(bne.rs2) ? pc + 4 + bne.imm : pc + 8;
+    ++fused[3];
+    ++retired;
+}
+
+template <size_t... I>
+constexpr std::array<cpu::handler, sizeof...(I)> cpu::handlers(std::index_sequence<I...>) {
+    return {&cpu::exec<static_cast<opcode>(I)>...};
+}
+
+void cpu::execute_instruction(const instruction &in) {
+    // generated in enum order, every opcode gets the handler for its own row of ISA
+    static constexpr auto table = handlers(std::make_index_sequence<OPCODES_COUNT>{});
+    (this->*table[static_cast<size_t>(in.op)])(in);
+
+#ifdef RISCV_COUNTERS
+    // only the last instruction of a block can branch, _next_pc is stale for the others
+    _mix.retire(in);
+    _mix.branch(in, pc, _next_pc);
+#endif
+}
+
+void cpu::execute_switch(const program &prog) {
+    const auto &code = prog.code;
+    const std::atomic<bool> &exited = _sys.exit_flag();
+
+    // runs until control leaves the program or lands between two instructions,
+    // execute() tells the two apart
+    while (true) {
+        const uint32_t offset = pc - prog.base;
+        const size_t idx = offset >> 2;
+        if (idx >= code.size() || (offset & 3)) return;
+        if (exited.load(std::memory_order_relaxed)) {
+            raise(status::EXITED);
+            return;
+        }
 
-void cpu::instr_ble(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+        _next_pc = pc + 4;
+        execute_instruction(code[idx]);
+        ++retired;
+        if (trapped()) return;
+        pc = _next_pc;
+    }
 }
 
-void cpu::instr_bgtu(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+void cpu::execute_blocks(const program &prog) {
+    const auto &code = prog.code;
+    _blocks.bind(prog);
+
+    const std::atomic<bool> &exited = _sys.exit_flag();
+    basic_block *block = _blocks.lookup(pc);
+    while (block) {
+        // another hart's exit_group is seen once per block
+        if (exited.load(std::memory_order_relaxed)) {
+            raise(status::EXITED);
+            return;
+        }
+        ++block->executions;
+
+        // everything before the last instruction falls through, no pc checks needed
+        const instruction *first = &code[block->index];
+        const instruction *last = first + block->length - 1;
+        for (const instruction *in = first; in != last; ++in) {
+            execute_instruction(*in);
+            if (trapped()) {
+                // like the switch, the instruction that trapped counts as retired
+                retired += in - first + 1;
+                return;
+            }
+            pc += 4;
+        }
+
+        _next_pc = pc + 4;
+        execute_instruction(*last);
+        retired += block->length;
+        if (trapped()) return;
+        pc = _next_pc;
+        block = _blocks.next(*block, pc);
+    }
 }
 
-void cpu::instr_bleu(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3) {
+void cpu::execute_jit(const program &prog) {
+    const auto &code = prog.code;
+    if (_blocks.bind(prog)) _jit.reset();
+
+    const std::atomic<bool> &exited = _sys.exit_flag();
+    basic_block *block = _blocks.lookup(pc);
+    while (block) {
+        // another hart's exit_group is seen once per block
+        if (exited.load(std::memory_order_relaxed)) {
+            raise(status::EXITED);
+            return;
+        }
+        ++block->executions;
+
+        const instruction *first = &code[block->index];
+        const instruction *in = first;
+        const instruction *last = first + block->length - 1;
+
+        // the last instruction is always interpreted, it decides where control goes
+        if (!block->compiled && block->executions >= JIT_THRESHOLD) {
+            block->native = _jit.compile(in, block->length - 1, block->start, block->native_length);
+            block->compiled = true;
+        }
+        if (block->native) {
+            block->native(registers.data());
+#ifdef RISCV_COUNTERS
+            for (uint32_t i = 0; i < block->native_length; ++i) _mix.retire(in[i]);
+#endif
+            in += block->native_length;
+            pc += 4 * block->native_length;
+        }
+
+        for (; in != last; ++in) {
+            execute_instruction(*in);
+            if (trapped()) {
+                retired += in - first + 1;
+                return;
+            }
+            pc += 4;
+        }
+
+        _next_pc = pc + 4;
+        execute_instruction(*last);
+        retired += block->length;
+        if (trapped()) return;
+        pc = _next_pc;
+        block = _blocks.next(*block, pc);
+    }
 }
 
-constexpr unsigned int cpu::hash(const char *s) {
-    unsigned int h = 5381;
-    while (*s) {
-        h = (h * 33) ^ *s;
-        s++;
+#ifdef RISCV_THREADED_DISPATCH
+// labels cannot be generated, so the engine spells the opcodes once more. the list
+// is checked against the enum, everything else about a handler comes from ISA
+#define THREADED_OPCODES(X)                                                                         \
+    X(RET) X(NOP) X(ECALL) X(EBREAK) X(J) X(CALL) X(TAIL) X(LB) X(LH) X(LW) X(LBU) X(LHU) X(SB)     \
+    X(SH) X(SW) X(LI) X(LUI) X(AUIPC) X(MV) X(SEXT_W) X(NEG) X(NEGW) X(SEQZ) X(SNEZ) X(NOT)         \
+    X(JAL) X(JR) X(SLTZ) X(SGTZ) X(ADDI) X(ADD) X(SUBI) X(SUB) X(XORI) X(XOR) X(ORI) X(OR)          \
+    X(ANDI) X(AND) X(SLLI) X(SLL) X(SRA) X(SRLI) X(SRL) X(SLTI) X(SLT) X(SLTIU) X(SLTU) X(BEQ)      \
+    X(BNE) X(BLT) X(BGE) X(BLTU) X(BGEU) X(JALR) X(MUL) X(MULH) X(MULSU) X(MULU) X(DIV) X(DIVU)     \
+    X(REM) X(REMU) X(BGT) X(BLE) X(BGTU) X(BLEU) X(SRAI) X(MULHU) X(UNIMP) X(LR_W) X(SC_W)          \
+    X(AMOSWAP_W) X(AMOADD_W) X(AMOXOR_W) X(AMOAND_W) X(AMOOR_W) X(AMOMIN_W) X(AMOMAX_W)             \
+    X(AMOMINU_W) X(AMOMAXU_W) X(FENCE) X(CSRR) X(LUI_ADDI) X(SLT_BNEZ) X(AUIPC_JALR) X(ADDI_BNE)
+
+template <size_t N>
+static constexpr bool in_enum_order(const opcode (&ops)[N]) {
+    if (N != OPCODES_COUNT) return false;
+    for (size_t i = 0; i < N; ++i)
+        if (static_cast<size_t>(ops[i]) != i) return false;
+    return true;
+}
+#define OPCODE_OF(OP) opcode::OP,
+static constexpr opcode THREADED_ORDER[] = {THREADED_OPCODES(OPCODE_OF)};
+#undef OPCODE_OF
+static_assert(in_enum_order(THREADED_ORDER), "THREADED_OPCODES must list every opcode in enum order");
+
+void cpu::execute_threaded(const program &prog) {
+    static const void *const dispatch_table[] = {
+#define LABEL_ADDRESS(OP) &&op_##OP,
+        THREADED_OPCODES(LABEL_ADDRESS)
+#undef LABEL_ADDRESS
+    };
+
+    const instruction *const begin = prog.code.data();
+    const instruction *const end = begin + prog.code.size();
+    const instruction *in = begin;
+    const std::atomic<bool> &exited = _sys.exit_flag();
+
+    // like the switch every handler that ran counts once, a superinstruction's second half
+    // is counted by its handler. the member would be reloaded around each handler, the
+    // local is added on the way out
+    struct retire_on_exit {
+        uint64_t &count, &retired;
+        ~retire_on_exit() { retired += count; }
+    };
+    uint64_t count = 0;
+    const retire_on_exit flush{count, retired};
+
+    // every handler ends in its own indirect jump, straight-line code never touches _next_pc
+#ifdef RISCV_COUNTERS
+#define COUNT_RETIRE() _mix.retire(*in)
+#define COUNT_BRANCH() _mix.branch(*in, pc, _next_pc)
+#else
+#define COUNT_RETIRE() ((void) 0)
+#define COUNT_BRANCH() ((void) 0)
+#endif
+#define DISPATCH()                                                                              \
+    do {                                                                                        \
+        COUNT_RETIRE();                                                                         \
+        goto *dispatch_table[static_cast<size_t>(in->op)];                                      \
+    } while (0)
+#define NEXT()                                                                                  \
+    do {                                                                                        \
+        pc += 4;                                                                                \
+        if (++in == end) return;                                                                \
+        DISPATCH();                                                                             \
+    } while (0)
+// only handlers that touch memory can trap
+#define CHECKED_NEXT()                                                                          \
+    do {                                                                                        \
+        if (trapped()) return;                                                                  \
+        NEXT();                                                                                 \
+    } while (0)
+#define ENTER()                                                                                 \
+    do {                                                                                        \
+        const uint32_t offset = pc - prog.base;                                                 \
+        if ((offset >> 2) >= prog.code.size() || (offset & 3)) return;                          \
+        in = begin + (offset >> 2);                                                             \
+        DISPATCH();                                                                             \
+    } while (0)
+// every loop takes a jump, another hart's exit_group is seen there
+#define JUMP()                                                                                  \
+    do {                                                                                        \
+        COUNT_BRANCH();                                                                         \
+        pc = _next_pc;                                                                          \
+        if (exited.load(std::memory_order_relaxed)) {                                           \
+            raise(status::EXITED);                                                              \
+            return;                                                                             \
+        }                                                                                       \
+        ENTER();                                                                                \
+    } while (0)
+// the tail comes from the opcode's flow, only one branch of it survives
+#define HANDLER(OP)                                                                             \
+    op_##OP:                                                                                    \
+    if constexpr (flow_of(opcode::OP) == flow::JUMP) _next_pc = pc + 4;                         \
+    exec<opcode::OP>(*in);                                                                      \
+    ++count;                                                                                    \
+    if constexpr (flow_of(opcode::OP) == flow::NEXT) NEXT();                                    \
+    else if constexpr (flow_of(opcode::OP) == flow::CHECKED) CHECKED_NEXT();                    \
+    else if constexpr (flow_of(opcode::OP) == flow::JUMP) JUMP();                               \
+    else if constexpr (flow_of(opcode::OP) == flow::PAIR) {                                     \
+        pc += 4;                                                                                \
+        ++in;                                                                                   \
+        NEXT();                                                                                 \
+    } else                                                                                      \
+        return;
+
+    ENTER();
+
+    THREADED_OPCODES(HANDLER)
+
+#undef HANDLER
+#undef JUMP
+#undef ENTER
+#undef CHECKED_NEXT
+#undef NEXT
+#undef DISPATCH
+#undef COUNT_BRANCH
+#undef COUNT_RETIRE
+}
+#undef THREADED_OPCODES
+#endif
+
+void cpu::raise(const status cause, const uint32_t address, const uint8_t width) {
+    _trap = {cause, pc, address, width};
+}
+
+status cpu::execute(const program &prog, const engine mode) {
+    pc = prog.entry;
+    _trap = {};
+    _reservation = {};
+    retired = 0;
+    return resume(prog, mode);
+}
+
+status cpu::resume(const program &prog, const engine mode) {
+    if (_trap.cause == status::BREAKPOINT) pc += 4;
+    _trap = {};
+    _sys.bind(prog);
+
+    if (mode == engine::BLOCK)
+        execute_blocks(prog);
+    else if (mode == engine::JIT)
+        execute_jit(prog);
+#ifdef RISCV_THREADED_DISPATCH
+    else if (mode == engine::THREADED)
+        execute_threaded(prog);
+#endif
+    else
+        execute_switch(prog);
+
+    return finish(prog);
+}
+
+status cpu::finish(const program &prog) {
+    // the engines stop without raising when pc is inside the program but misaligned
+    const uint32_t offset = pc - prog.base;
+    if (!trapped() && (offset >> 2) < prog.code.size() && (offset & 3)) raise(status::MISALIGNED_PC);
+
+    // guest output comes before whatever the host prints about the run
+    _sys.flush();
+    return trapped() ? _trap.cause : status::HALTED;
+}
+
+// runs after in executed at pc, _next_pc is where it sent control
+void cpu::track_calls(const instruction &in, profiler &prof) const {
+    switch (in.op) {
+        case opcode::CALL:
+            prof.call(_next_pc, pc + 4);
+            break;
+        case opcode::JAL:
+        case opcode::JALR:
+            if (in.rd == RA) prof.call(_next_pc, pc + 4);
+            else if (in.op == opcode::JALR && in.rs1 == RA) prof.ret(_next_pc);
+            break;
+        case opcode::AUIPC_JALR:
+            if ((&in)[1].rd == RA) prof.call(_next_pc, pc + 8);
+            break;
+        case opcode::RET:
+            prof.ret(_next_pc);
+            break;
+        case opcode::JR:
+            if (in.rs1 == RA) prof.ret(_next_pc);
+            break;
+        case opcode::TAIL:
+            prof.tail(_next_pc);
+            break;
+        default:
+            break;
     }
-    return h;
 }
 
-std::string cpu::clean_args_and_get_instruction(std::string &op, std::string &arg1, std::string &arg2, std::string &arg3) const {
-    if (is_comment(op)) {
-        op.clear();
-        return "";
+status cpu::execute_profiled(const program &prog, profiler &prof) {
+    const auto &code = prog.code;
+    pc = prog.entry;
+    _trap = {};
+    _reservation = {};
+    retired = 0;
+    _sys.bind(prog);
+
+    while (true) {
+        const uint32_t offset = pc - prog.base;
+        const size_t idx = offset >> 2;
+        if (idx >= code.size() || (offset & 3)) break;
+
+        prof.tick(pc);
+        _next_pc = pc + 4;
+        execute_instruction(code[idx]);
+        ++retired;
+        if (trapped()) break;
+
+        track_calls(code[idx], prof);
+        pc = _next_pc;
     }
 
-    if (is_comment(arg1)) {
-        arg1.clear();
-        arg2.clear();
-        arg3.clear();
-        return op;
+    return finish(prog);
+}
+
+// runs after in retired at pc, registers it did not change are dropped by the writer
+void cpu::trace_effects(const instruction &in, trace_writer &trace) const {
+    trace.begin(pc, in.op == opcode::ECALL ? _sys.written_count() : 0);
+    trace.reg(in.rd, registers[in.rd]);
+    switch (in.op) {
+        case opcode::CALL:
+            trace.reg(RA, registers[RA]);
+            break;
+        case opcode::ECALL:
+            // the result and whatever the host stored into guest memory, as one store
+            trace.reg(A0, registers[A0]);
+            if (const uint32_t count = _sys.written_count()) {
+                uint8_t *bytes = trace.store_bulk(_sys.written(), count);
+                for (uint32_t i = 0; i < count; ++i) bytes[i] = peek<uint8_t>(_sys.written() + i);
+            }
+            break;
+        case opcode::AUIPC_JALR:
+            trace.reg((&in)[1].rd, registers[(&in)[1].rd]);
+            break;
+        case opcode::SB:
+            trace.store(get_address(in), 0, registers[in.rs2] & 0xff);
+            break;
+        case opcode::SH:
+            trace.store(get_address(in), 1, registers[in.rs2] & 0xffff);
+            break;
+        case opcode::SW:
+            trace.store(get_address(in), 2, registers[in.rs2]);
+            break;
+        case opcode::SC_W:
+            if (registers[in.rd] != 0) break;
+            [[fallthrough]];
+        case opcode::AMOSWAP_W:
+        case opcode::AMOADD_W:
+        case opcode::AMOXOR_W:
+        case opcode::AMOAND_W:
+        case opcode::AMOOR_W:
+        case opcode::AMOMIN_W:
+        case opcode::AMOMAX_W:
+        case opcode::AMOMINU_W:
+        case opcode::AMOMAXU_W:
+            trace.store(_amo_address, 2, peek<uint32_t>(_amo_address));
+            break;
+        default:
+            break;
     }
+    trace.commit();
+}
+
+status cpu::execute_traced(const program &prog, trace_writer &trace) {
+    const auto &code = prog.code;
+    pc = prog.entry;
+    _trap = {};
+    _reservation = {};
+    retired = 0;
+    _sys.bind(prog);
 
-    if (is_comment(arg2)) {
-        arg2.clear();
-        arg3.clear();
-        return op + " " + arg1;
+    while (true) {
+        const uint32_t offset = pc - prog.base;
+        const size_t idx = offset >> 2;
+        if (idx >= code.size() || (offset & 3)) break;
+
+        _next_pc = pc + 4;
+        execute_instruction(code[idx]);
+        ++retired;
+        if (trapped()) break;
+
+        trace_effects(code[idx], trace);
+        pc = _next_pc;
     }
 
-    if (is_comment(arg3)) {
-        arg3.clear();
-        return op + " " + arg1 + ", " + arg2;
+    return finish(prog);
+}
+
+std::string cpu::describe_trap(const program &prog) const {
+    std::ostringstream oss;
+    switch (_trap.cause) {
+        case status::RUNNING:
+        case status::HALTED:
+            return "";
+        case status::ILLEGAL_INSTRUCTION:
+            oss << "Illegal instruction at pc: " << _trap.pc;
+            break;
+        case status::MISALIGNED_PC:
+            return "Misaligned pc: " + std::to_string(_trap.pc);
+        case status::BREAKPOINT:
+            oss << "Breakpoint at pc: " << _trap.pc;
+            break;
+        case status::EXITED:
+            // after exit_group every hart reports the code it was called with
+            oss << "Exited with code " << (_sys.exit_flag() ? _sys.exit_code() : static_cast<int32_t>(registers[A0]));
+            break;
+        case status::LOAD_FAULT:
+        case status::STORE_FAULT:
+            oss << (_trap.cause == status::LOAD_FAULT ? "Load" : "Store") << " access fault: "
+                << static_cast<unsigned>(_trap.width) << " bytes at 0x" << std::hex << _trap.address;
+            break;
     }
 
-    return op + " " + arg1 + ", " + arg2 + ", " + arg3;
-}
-
-void cpu::execute_instruction(std::string &inst, uint64_t line_number) {
-    prepare_instruction(inst);
-    std::istringstream iss(inst);
-    std::string op, arg1, arg2, arg3;
-    iss >> op >> arg1 >> arg2 >> arg3;
-
-    std::string debug_line = std::move(clean_args_and_get_instruction(op, arg1, arg2, arg3));
-    if (op.empty()) return;
-
-    size_t args = !arg1.empty() + !arg2.empty() + !arg3.empty();
-    try {
-        switch (hash(op.c_str())) {
-            /* 0 args */
-            case hash("ret"):    instr_ret(args == 0); break;
-            case hash("nop"):    instr_nop(args == 0); break;
-            case hash("ecall"):  instr_ecall(args == 0); break;
-            case hash("ebreak"): instr_ebreak(args == 0); break;
-
-            /* 1 args */
-            case hash("j"):      instr_j(args == 1, arg1); break;
-            case hash("call"):   instr_call(args == 1, arg1); break;
-            case hash("tail"):   instr_tail(args == 1, arg1); break;
-
-            /* 2 args */
-            case hash("lb"):     instr_lb(args == 2, arg1, arg2); break;
-            case hash("lh"):     instr_lh(args == 2, arg1, arg2); break;
-            case hash("lw"):     instr_lw(args == 2, arg1, arg2); break;
-            case hash("lbu"):    instr_lbu(args == 2, arg1, arg2); break;
-            case hash("lhu"):    instr_lhu(args == 2, arg1, arg2); break;
-            case hash("sb"):     instr_sb(args == 2, arg1, arg2); break;
-            case hash("sh"):     instr_sh(args == 2, arg1, arg2); break;
-            case hash("sw"):     instr_sw(args == 2, arg1, arg2); break;
-            case hash("li"):     instr_li(args == 2, arg1, arg2); break;
-            case hash("lui"):    instr_lui(args == 2, arg1, arg2); break;
-            case hash("auipc"):  instr_auipc(args == 2, arg1, arg2); break;
-            case hash("mv"):     instr_mv(args == 2, arg1, arg2); break;
-            case hash("sext.w"): instr_sextw(args == 2, arg1, arg2); break;
-            case hash("neg"):    instr_neg(args == 2, arg1, arg2); break;
-            case hash("negw"):   instr_negw(args == 2, arg1, arg2); break;
-            case hash("seqz"):   instr_seqz(args == 2, arg1, arg2); break;
-            case hash("snez"):   instr_snez(args == 2, arg1, arg2); break;
-            case hash("not"):    instr_not(args == 2, arg1, arg2); break;
-            case hash("jal"):    instr_jal(args == 2, arg1, arg2); break;
-            case hash("jr"):     instr_jr(args == 2, arg1, arg2); break;
-            case hash("sltz"):   instr_sltz(args == 2, arg1, arg2); break;
-            case hash("sgtz"):   instr_sgtz(args == 2, arg1, arg2); break;
-
-            /* 3 args */
-            case hash("add"):    instr_add(args == 3, arg1, arg2, arg3); break;
-            case hash("addi"):   instr_addi(args == 3, arg1, arg2, arg3); break;
-            case hash("xor"):    instr_xor(args == 3, arg1, arg2, arg3); break;
-            case hash("xori"):   instr_xori(args == 3, arg1, arg2, arg3); break;
-            case hash("or"):     instr_or(args == 3, arg1, arg2, arg3); break;
-            case hash("ori"):    instr_ori(args == 3, arg1, arg2, arg3); break;
-            case hash("and"):    instr_and(args == 3, arg1, arg2, arg3); break;
-            case hash("andi"):   instr_andi(args == 3, arg1, arg2, arg3); break;
-            case hash("sll"):    instr_sll(args == 3, arg1, arg2, arg3); break;
-            case hash("slli"):   instr_slli(args == 3, arg1, arg2, arg3); break;
-            case hash("srli"):   instr_srli(args == 3, arg1, arg2, arg3); break;
-            case hash("srl"):    instr_srl(args == 3, arg1, arg2, arg3); break;
-            case hash("srai"):   instr_srai(args == 3, arg1, arg2, arg3); break;
-            case hash("sra"):    instr_sra(args == 3, arg1, arg2, arg3); break;
-            case hash("sub"):    instr_sub(args == 3, arg1, arg2, arg3); break;
-            case hash("slt"):    instr_slt(args == 3, arg1, arg2, arg3); break;
-            case hash("slti"):   instr_slti(args == 3, arg1, arg2, arg3); break;
-            case hash("sltu"):   instr_sltu(args == 3, arg1, arg2, arg3); break;
-            case hash("sltiu"):  instr_sltiu(args == 3, arg1, arg2, arg3); break;
-            case hash("beq"):    instr_beq(args == 3, arg1, arg2, arg3); break;
-            case hash("bne"):    instr_bne(args == 3, arg1, arg2, arg3); break;
-            case hash("blt"):    instr_blt(args == 3, arg1, arg2, arg3); break;
-            case hash("bge"):    instr_bge(args == 3, arg1, arg2, arg3); break;
-            case hash("bltu"):   instr_bltu(args == 3, arg1, arg2, arg3); break;
-            case hash("bgeu"):   instr_bgeu(args == 3, arg1, arg2, arg3); break;
-            case hash("jalr"):   instr_jalr(args == 3, arg1, arg2, arg3); break;
-            case hash("mul"):    instr_mul(args == 3, arg1, arg2, arg3); break;
-            case hash("mulh"):   instr_mulh(args == 3, arg1, arg2, arg3); break;
-            case hash("mulsu"):  instr_mulsu(args == 3, arg1, arg2, arg3); break;
-            case hash("mulu"):   instr_mulu(args == 3, arg1, arg2, arg3); break;
-            case hash("div"):    instr_div(args == 3, arg1, arg2, arg3); break;
-            case hash("divu"):   instr_divu(args == 3, arg1, arg2, arg3); break;
-            case hash("rem"):    instr_rem(args == 3, arg1, arg2, arg3); break;
-            case hash("remu"):   instr_remu(args == 3, arg1, arg2, arg3); break;
-            case hash("bgt"):    instr_bgt(args == 3, arg1, arg2, arg3); break;
-            case hash("ble"):    instr_ble(args == 3, arg1, arg2, arg3); break;
-            case hash("bgtu"):   instr_bgtu(args == 3, arg1, arg2, arg3); break;
-            case hash("bleu"):   instr_bleu(args == 3, arg1, arg2, arg3); break;
-
-            default:
-                throw std::invalid_argument("Operation not implemented: " + op);
-        }
-    } catch (std::invalid_argument& e) {
-        std::string msg = e.what();
-        throw std::invalid_argument(
-            "\n"
-            "==================== CPU EXCEPTION ====================\n"
-            " [?] Location:    line " + std::to_string(line_number) + "\n"
-            " [!] Instruction: " + debug_line + "\n"
-            " [X] Error:       " + msg + "\n"
-            "=======================================================\n"
-        );    }
-}
\ No newline at end of file
+    // the source line is looked up only now, assembled programs keep one per instruction
+    const size_t index = (_trap.pc - prog.base) >> 2;
+    if (index < prog.lines.size()) oss << std::dec << " (line " << prog.lines[index] << ")";
+    return oss.str();
+}
@@ -4,10 +4,22 @@
 
 #ifndef CPU_H
 #define CPU_H
-#include <any>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
-#include <array>
+#include <utility>
+#include <vector>
+
+#include "block_cache.h"
+#include "instruction.h"
+#include "instruction_mix.h"
+#include "isa.h"
+#include "jit.h"
+#include "memory.h"
+#include "profiler.h"
+#include "syscalls.h"
+#include "trace.h"
 
 constexpr size_t ZERO = 0;
 constexpr size_t RA = 1;
@@ -43,181 +55,170 @@ constexpr size_t T4 = 29;
 constexpr size_t T5 = 30;
 constexpr size_t T6 = 31;
 
-constexpr size_t INSTRUCTIONS_COUNT = 67;
-struct reg {
-    int32_t value;
-    char name[6];
+enum class engine : uint8_t {
+    SWITCH,
+    THREADED,
+    BLOCK,
+    JIT
+};
+
+#ifdef RISCV_THREADED_DISPATCH
+constexpr engine DEFAULT_ENGINE = engine::THREADED;
+#else
+constexpr engine DEFAULT_ENGINE = engine::SWITCH;
+#endif
+
+// how execute() ended, everything but HALTED is a trap
+enum class status : uint8_t {
+    RUNNING,
+    HALTED,             // control left the program
+    ILLEGAL_INSTRUCTION,
+    MISALIGNED_PC,
+    LOAD_FAULT,
+    STORE_FAULT,
+    BREAKPOINT,         // ebreak, resume() continues after it
+    EXITED              // the exit syscall, a0 holds the code
+};
+
+// the read-modify-write amo*.w, the ones with a host fetch op map straight onto it
+enum class amo_kind : uint8_t {
+    SWAP,
+    ADD,
+    XOR,
+    AND,
+    OR,
+    MIN,
+    MAX,
+    MINU,
+    MAXU
+};
+
+// recorded by the handler that trapped, the message is only built by describe_trap
+struct trap_info {
+    status      cause = status::RUNNING;
+    uint32_t    pc = 0;
+    uint32_t    address = 0; // of the faulting access
+    uint8_t     width = 0;
 };
 
 class cpu {
-    const std::array<char, 2> _valid_com_chars = {
-        '#',
-        ';'
-    };
-    const std::array<std::string, 67> _instructions = {
-        "ret",
-        "nop",
-        "ecall",
-        "ebreak",
-        "j",
-        "call",
-        "tail",
-        "lb",
-        "lh",
-        "lw",
-        "lbu",
-        "lhu",
-        "sb",
-        "sh",
-        "sw",
-        "li",
-        "lui",
-        "auipc",
-        "mv",
-        "sext.w",
-        "neg",
-        "negw",
-        "seqz",
-        "snez",
-        "not",
-        "jal",
-        "jr",
-        "sltz",
-        "sgtz",
-        "addi",
-        "add",
-        "subi",
-        "sub",
-        "xori",
-        "xor",
-        "ori",
-        "or",
-        "andi",
-        "and",
-        "slli",
-        "sll",
-        "sra",
-        "srli",
-        "srl",
-        "slti",
-        "slt",
-        "sltiu",
-        "sltu",
-        "beq",
-        "bne",
-        "blt",
-        "bge",
-        "bltu",
-        "bgeu",
-        "jalr",
-        "mul",
-        "mulh",
-        "mulsu",
-        "mulu",
-        "div",
-        "divu",
-        "rem",
-        "remu",
-        "bgt",
-        "ble",
-        "bgtu",
-        "bleu"
+    // indices come from decoded instructions, x0 reads as 0 and its writes go to SINK
+    [[nodiscard]] int32_t           get_register_value(const size_t idx) const { return static_cast<int32_t>(registers[idx]); }
+    [[nodiscard]] uint32_t          get_register_value_unsigned(const size_t idx) const { return registers[idx]; }
+    void                            write_register(const size_t idx, const int32_t value) { registers[idx] = static_cast<uint32_t>(value); }
+    void                            jump(uint32_t target);
+    void                            execute_switch(const program& prog);
+    void                            execute_blocks(const program& prog);
+    void                            execute_jit(const program& prog);
+#ifdef RISCV_THREADED_DISPATCH
+    void                            execute_threaded(const program& prog);
+#endif
+
+    [[nodiscard]] uint32_t          get_address(const instruction& in) const;
+    void                            raise(status cause, uint32_t address = 0, uint8_t width = 0);
+    [[nodiscard]] status            finish(const program& prog);
+    void                            track_calls(const instruction& in, profiler& prof) const;
+    void                            trace_effects(const instruction& in, trace_writer& trace) const;
+    [[nodiscard]] bool              trapped() const { return _trap.cause != status::RUNNING; }
+    // reads for the tracer, nothing is raised and out of range reads 0
+    template <typename T>
+    [[nodiscard]] T                 peek(const uint32_t addr) const {
+        if (_model == memory_model::PAGED) return paged.load<T>(addr);
+
+        T value = 0;
+        return memory.load<T>(addr, value) ? value : 0;
+    }
+    template <amo_kind K>
+    void                            amo(const instruction& in);
+
+    // both models are always present, the branch on _model is perfectly predicted.
+    // false after a fault, which is already raised
+    template <typename T>
+    [[nodiscard]] bool load(const uint32_t addr, T& value) {
+        if (_model == memory_model::PAGED) {
+            value = paged.load<T>(addr);
+            return true;
+        }
+
+        if (memory.load<T>(addr, value)) return true;
+
+        raise(status::LOAD_FAULT, addr, sizeof(T));
+        return false;
+    }
+    template <typename T>
+    void store(const uint32_t addr, const T value) {
+        if (_model == memory_model::PAGED)
+            paged.store<T>(addr, value);
+        else if (!memory.store<T>(addr, value))
+            raise(status::STORE_FAULT, addr, sizeof(T));
+    }
+
+    memory_model                    _model;
+    block_cache                     _blocks;
+    jit                             _jit;
+    syscalls                        _sys;
+
+    uint32_t                        _next_pc = 0;
+    trap_info                       _trap;
+
+    // set by lr.w, any sc.w clears it. sc.w succeeds when the word still holds the value
+    // lr.w read, so a change and a change back in between goes unnoticed
+    struct reservation {
+        uint32_t    address = 0;
+        uint32_t    value = 0; // as stored in guest memory
+        bool        valid = false;
     };
+    reservation                     _reservation;
+    uint32_t                        _amo_address = 0; // of the last atomic, rd may have overwritten rs1 since
+#ifdef RISCV_COUNTERS
+    instruction_mix                 _mix;
+#endif
 
-    [[nodiscard]] static size_t     get_register_index(const std::string& reg_name);
-    [[nodiscard]] static int16_t    get_imm12(const std::string& s);
-    [[nodiscard]] static int32_t    get_imm20(const std::string& s);
-    [[nodiscard]] static uint32_t   get_bits_from_range(uint32_t num, size_t start = 0, size_t end = 31);
-    [[nodiscard]] int32_t           get_register_value(size_t idx) const;
-    [[nodiscard]] uint32_t          get_register_value_unsigned(size_t idx) const;
-    void                            write_register(size_t idx, int32_t value);
-    static void                     prepare_instruction(std::string& inst);
-    [[nodiscard]] bool              is_comment(const std::string& s) const;
-    [[nodiscard]] std::string       clean_args_and_get_instruction(std::string &op, std::string &arg1, std::string &arg2, std::string &arg3) const;
-
-
-    [[nodiscard]] static constexpr unsigned int hash(const char *s);
-    /* INSTRUCTIONS */
-    void                instr_ret(bool args_ok);
-    void                instr_nop(bool args_ok);
-    void                instr_ecall(bool args_ok);
-    void                instr_ebreak(bool args_ok);
-
-    void                instr_j(bool args_ok, const std::string& arg1);
-    void                instr_call(bool args_ok, const std::string& arg1);
-    void                instr_tail(bool args_ok, const std::string& arg1);
-
-    void                instr_lb(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_lh(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_lw(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_lbu(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_lhu(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sb(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sh(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sw(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_li(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_lui(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_auipc(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_mv(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sextw(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_neg(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_negw(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_seqz(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_snez(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_not(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_jal(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_jr(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sltz(bool args_ok, const std::string& arg1, const std::string& arg2);
-    void                instr_sgtz(bool args_ok, const std::string& arg1, const std::string& arg2);
-
-    void                instr_add(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_addi(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_sub(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_xor(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_xori(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_or(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_ori(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_and(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_andi(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_sll(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_slli(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_srl(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_srli(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_sltu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_sltiu(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3);
-    void                instr_slt(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_slti(bool args_ok, const std::string &arg1, const std::string &arg2, const std::string &arg3);
-    void                instr_sra(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_srai(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_beq(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bne(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_blt(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bge(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bltu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bgeu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_jalr(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_mul(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_mulh(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_mulsu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_mulu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_div(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_divu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_rem(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_remu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bgt(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_ble(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bgtu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
-    void                instr_bleu(bool args_ok, const std::string& arg1, const std::string& arg2, const std::string& arg3);
+    // one explicit specialization per opcode in cpu.cpp, an opcode without one does not compile.
+    // superinstructions read their second half from the next slot
+    template <opcode OP>
+    void                exec(const instruction& in) = delete;
+    using handler = void (cpu::*)(const instruction&);
+    template <size_t... I>
+    static constexpr std::array<handler, sizeof...(I)> handlers(std::index_sequence<I...>);
 public:
-    cpu();
-    static uint32_t     stoui_offset(const std::string& s, size_t offset);
+    // memory_size only applies to the flat model, the paged model spans all 4 GiB
+    explicit cpu(uint64_t memory_size = DEFAULT_MEMORY_SIZE, memory_model model = memory_model::FLAT);
+    [[nodiscard]] static uint32_t get_bits_from_range(uint32_t num, size_t start = 0, size_t end = 31);
     void                print_registers(bool hex = true) const;
-    void                execute_instruction(std::string& inst, uint64_t line_number);
+    void                map_segments(const program& prog);
+    void                execute_instruction(const instruction& in);
+    // engine::THREADED silently falls back to the switch when it was not compiled in,
+    // engine::JIT interprets every block on hosts the jit does not support.
+    // nothing is thrown once execution starts, traps stop it and are returned
+    status              execute(const program& prog, engine mode = DEFAULT_ENGINE);
+    // continues from pc without resetting retired, past the ebreak when execution stopped on one
+    status              resume(const program& prog, engine mode = DEFAULT_ENGINE);
+    // the switch engine with a profiler watching every step
+    status              execute_profiled(const program& prog, profiler& prof);
+    // the switch engine recording every retired instruction, the caller finishes the trace
+    status              execute_traced(const program& prog, trace_writer& trace);
+    [[nodiscard]] const trap_info& last_trap() const { return _trap; }
+    [[nodiscard]] memory_model      model() const { return _model; }
+    // the guest process behind ecall, smp replaces it with a view shared by its harts
+    [[nodiscard]] syscalls&         sys() { return _sys; }
+    [[nodiscard]] std::string describe_trap(const program& prog) const;
+#ifdef RISCV_COUNTERS
+    [[nodiscard]] const instruction_mix& mix() const { return _mix; }
+#endif
 
 
     // data
-    std::array<reg, 32> registers;
-    std::vector<uint32_t> stack;
+    // x0 is never written, the values share two cache lines and the sink a third
+    alignas(64) std::array<uint32_t, REGISTER_SLOTS> registers = {};
+    uint32_t            pc = 0;
+    // counted per step by the switch and the threaded engine and per block by the block
+    // engines. a superinstruction counts as the two instructions it replaced
+    uint64_t            retired = 0;
+    uint32_t            hart_id = 0; // read by csrr mhartid, smp numbers its harts from 0
+    flat_memory         memory;
+    paged_memory        paged;
+    std::array<uint64_t, FUSED_COUNT> fused = {}; // executions of each superinstruction
 };
 
 #endif //CPU_H
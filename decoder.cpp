@@ -0,0 +1,240 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include "decoder.h"
+#include "cpu.h"
+
+constexpr uint32_t OPC_LOAD     = 0b0000011;
+constexpr uint32_t OPC_MISC_MEM = 0b0001111;
+constexpr uint32_t OPC_OP_IMM   = 0b0010011;
+constexpr uint32_t OPC_AUIPC    = 0b0010111;
+constexpr uint32_t OPC_STORE    = 0b0100011;
+constexpr uint32_t OPC_AMO      = 0b0101111;
+constexpr uint32_t OPC_OP       = 0b0110011;
+constexpr uint32_t OPC_LUI      = 0b0110111;
+constexpr uint32_t OPC_BRANCH   = 0b1100011;
+constexpr uint32_t OPC_JALR     = 0b1100111;
+constexpr uint32_t OPC_JAL      = 0b1101111;
+constexpr uint32_t OPC_SYSTEM   = 0b1110011;
+
+constexpr uint32_t FUNCT7_BASE   = 0b0000000;
+constexpr uint32_t FUNCT7_ALT    = 0b0100000;
+constexpr uint32_t FUNCT7_MULDIV = 0b0000001;
+
+uint8_t decoder::get_rd(const uint32_t raw) {
+    return static_cast<uint8_t>(cpu::get_bits_from_range(raw, 7, 11));
+}
+uint8_t decoder::get_rs1(const uint32_t raw) {
+    return static_cast<uint8_t>(cpu::get_bits_from_range(raw, 15, 19));
+}
+uint8_t decoder::get_rs2(const uint32_t raw) {
+    return static_cast<uint8_t>(cpu::get_bits_from_range(raw, 20, 24));
+}
+uint32_t decoder::get_funct3(const uint32_t raw) {
+    return cpu::get_bits_from_range(raw, 12, 14);
+}
+uint32_t decoder::get_funct7(const uint32_t raw) {
+    return cpu::get_bits_from_range(raw, 25, 31);
+}
+
+int32_t decoder::sign_extend(const uint32_t value, const size_t bits) {
+    const size_t shift = 32 - bits;
+    return static_cast<int32_t>(value << shift) >> shift;
+}
+int32_t decoder::get_imm_i(const uint32_t raw) {
+    return sign_extend(cpu::get_bits_from_range(raw, 20, 31), 12);
+}
+int32_t decoder::get_imm_s(const uint32_t raw) {
+    return sign_extend(cpu::get_bits_from_range(raw, 25, 31) << 5 | cpu::get_bits_from_range(raw, 7, 11), 12);
+}
+int32_t decoder::get_imm_b(const uint32_t raw) {
+    return sign_extend(cpu::get_bits_from_range(raw, 31, 31) << 12 |
+                       cpu::get_bits_from_range(raw, 7, 7) << 11 |
+                       cpu::get_bits_from_range(raw, 25, 30) << 5 |
+                       cpu::get_bits_from_range(raw, 8, 11) << 1, 13);
+}
+int32_t decoder::get_imm_u(const uint32_t raw) {
+    // kept as the 20 bit value, lui/auipc shift it back into place
+    return sign_extend(cpu::get_bits_from_range(raw, 12, 31), 20);
+}
+int32_t decoder::get_imm_j(const uint32_t raw) {
+    return sign_extend(cpu::get_bits_from_range(raw, 31, 31) << 20 |
+                       cpu::get_bits_from_range(raw, 12, 19) << 12 |
+                       cpu::get_bits_from_range(raw, 20, 20) << 11 |
+                       cpu::get_bits_from_range(raw, 21, 30) << 1, 21);
+}
+
+instruction decoder::decode_load(const uint32_t raw) {
+    opcode op;
+    switch (get_funct3(raw)) {
+        case 0b000: op = opcode::LB; break;
+        case 0b001: op = opcode::LH; break;
+        case 0b010: op = opcode::LW; break;
+        case 0b100: op = opcode::LBU; break;
+        case 0b101: op = opcode::LHU; break;
+        default:    return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+
+    return {op, get_rd(raw), get_rs1(raw), 0, get_imm_i(raw)};
+}
+
+instruction decoder::decode_store(const uint32_t raw) {
+    opcode op;
+    switch (get_funct3(raw)) {
+        case 0b000: op = opcode::SB; break;
+        case 0b001: op = opcode::SH; break;
+        case 0b010: op = opcode::SW; break;
+        default:    return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+
+    return {op, 0, get_rs1(raw), get_rs2(raw), get_imm_s(raw)};
+}
+
+instruction decoder::decode_branch(const uint32_t raw) {
+    opcode op;
+    switch (get_funct3(raw)) {
+        case 0b000: op = opcode::BEQ; break;
+        case 0b001: op = opcode::BNE; break;
+        case 0b100: op = opcode::BLT; break;
+        case 0b101: op = opcode::BGE; break;
+        case 0b110: op = opcode::BLTU; break;
+        case 0b111: op = opcode::BGEU; break;
+        default:    return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+
+    return {op, 0, get_rs1(raw), get_rs2(raw), get_imm_b(raw)};
+}
+
+instruction decoder::decode_op_imm(const uint32_t raw) {
+    const uint8_t rd = get_rd(raw);
+    const uint8_t rs1 = get_rs1(raw);
+    const int32_t imm = get_imm_i(raw);
+    const uint32_t funct7 = get_funct7(raw);
+    const auto shamt = static_cast<int32_t>(get_rs2(raw));
+
+    switch (get_funct3(raw)) {
+        case 0b000: return {opcode::ADDI, rd, rs1, 0, imm};
+        case 0b010: return {opcode::SLTI, rd, rs1, 0, imm};
+        case 0b011: return {opcode::SLTIU, rd, rs1, 0, imm};
+        case 0b100: return {opcode::XORI, rd, rs1, 0, imm};
+        case 0b110: return {opcode::ORI, rd, rs1, 0, imm};
+        case 0b111: return {opcode::ANDI, rd, rs1, 0, imm};
+        case 0b001:
+            if (funct7 != FUNCT7_BASE) return {opcode::UNIMP, 0, 0, 0, 0};
+
+            return {opcode::SLLI, rd, rs1, 0, shamt};
+        case 0b101:
+            if (funct7 == FUNCT7_BASE) return {opcode::SRLI, rd, rs1, 0, shamt};
+            if (funct7 == FUNCT7_ALT) return {opcode::SRAI, rd, rs1, 0, shamt};
+
+            return {opcode::UNIMP, 0, 0, 0, 0};
+        default:
+            return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+}
+
+instruction decoder::decode_op(const uint32_t raw) {
+    const uint32_t funct3 = get_funct3(raw);
+    const uint32_t funct7 = get_funct7(raw);
+
+    opcode op;
+    if (funct7 == FUNCT7_MULDIV) {
+        switch (funct3) {
+            case 0b000: op = opcode::MUL; break;
+            case 0b001: op = opcode::MULH; break;
+            case 0b010: op = opcode::MULSU; break;
+            case 0b011: op = opcode::MULHU; break;
+            case 0b100: op = opcode::DIV; break;
+            case 0b101: op = opcode::DIVU; break;
+            case 0b110: op = opcode::REM; break;
+            default:    op = opcode::REMU; break;
+        }
+    } else if (funct7 == FUNCT7_BASE) {
+        switch (funct3) {
+            case 0b000: op = opcode::ADD; break;
+            case 0b001: op = opcode::SLL; break;
+            case 0b010: op = opcode::SLT; break;
+            case 0b011: op = opcode::SLTU; break;
+            case 0b100: op = opcode::XOR; break;
+            case 0b101: op = opcode::SRL; break;
+            case 0b110: op = opcode::OR; break;
+            default:    op = opcode::AND; break;
+        }
+    } else if (funct7 == FUNCT7_ALT && funct3 == 0b000) {
+        op = opcode::SUB;
+    } else if (funct7 == FUNCT7_ALT && funct3 == 0b101) {
+        op = opcode::SRA;
+    } else {
+        return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+
+    return {op, get_rd(raw), get_rs1(raw), get_rs2(raw), 0};
+}
+
+instruction decoder::decode_amo(const uint32_t raw) {
+    // word width only, the aq and rl bits are ignored since every atomic is seq_cst
+    if (get_funct3(raw) != 0b010) return {opcode::UNIMP, 0, 0, 0, 0};
+
+    opcode op;
+    switch (cpu::get_bits_from_range(raw, 27, 31)) {
+        case 0b00010: op = opcode::LR_W;      break;
+        case 0b00011: op = opcode::SC_W;      break;
+        case 0b00001: op = opcode::AMOSWAP_W; break;
+        case 0b00000: op = opcode::AMOADD_W;  break;
+        case 0b00100: op = opcode::AMOXOR_W;  break;
+        case 0b01100: op = opcode::AMOAND_W;  break;
+        case 0b01000: op = opcode::AMOOR_W;   break;
+        case 0b10000: op = opcode::AMOMIN_W;  break;
+        case 0b10100: op = opcode::AMOMAX_W;  break;
+        case 0b11000: op = opcode::AMOMINU_W; break;
+        case 0b11100: op = opcode::AMOMAXU_W; break;
+        default:      return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+    if (op == opcode::LR_W && get_rs2(raw) != 0) return {opcode::UNIMP, 0, 0, 0, 0};
+
+    return {op, get_rd(raw), get_rs1(raw), op == opcode::LR_W ? uint8_t{0} : get_rs2(raw), 0};
+}
+
+instruction decoder::decode_misc_mem(const uint32_t raw) {
+    // fence.i has nothing to do, the decoded program never changes under the harts
+    if (get_funct3(raw) == 0b001) return {opcode::NOP, 0, 0, 0, 0};
+    if (get_funct3(raw) != 0b000) return {opcode::UNIMP, 0, 0, 0, 0};
+
+    return {opcode::FENCE, 0, 0, 0, 0};
+}
+
+instruction decoder::decode_system(const uint32_t raw) {
+    if (raw == 0x00000073) return {opcode::ECALL, 0, 0, 0, 0};
+    if (raw == 0x00100073) return {opcode::EBREAK, 0, 0, 0, 0};
+
+    // csrr rd, csr is csrrs rd, csr, x0, the only csr access that has no side effects
+    if (get_funct3(raw) == 0b010 && get_rs1(raw) == 0)
+        return {opcode::CSRR, get_rd(raw), 0, 0, static_cast<int32_t>(cpu::get_bits_from_range(raw, 20, 31))};
+
+    return {opcode::UNIMP, 0, 0, 0, 0};
+}
+
+instruction decoder::decode(const uint32_t raw) {
+    // 16 bit compressed encodings do not end in 0b11
+    if (cpu::get_bits_from_range(raw, 0, 1) != 0b11) return {opcode::UNIMP, 0, 0, 0, 0};
+
+    switch (cpu::get_bits_from_range(raw, 0, 6)) {
+        case OPC_LOAD:     return decode_load(raw);
+        case OPC_MISC_MEM: return decode_misc_mem(raw);
+        case OPC_OP_IMM:   return decode_op_imm(raw);
+        case OPC_AUIPC:    return {opcode::AUIPC, get_rd(raw), 0, 0, get_imm_u(raw)};
+        case OPC_STORE:    return decode_store(raw);
+        case OPC_AMO:      return decode_amo(raw);
+        case OPC_OP:       return decode_op(raw);
+        case OPC_LUI:      return {opcode::LUI, get_rd(raw), 0, 0, get_imm_u(raw)};
+        case OPC_BRANCH:   return decode_branch(raw);
+        case OPC_JALR:
+            if (get_funct3(raw) != 0) return {opcode::UNIMP, 0, 0, 0, 0};
+
+            return {opcode::JALR, get_rd(raw), get_rs1(raw), 0, get_imm_i(raw)};
+        case OPC_JAL:      return {opcode::JAL, get_rd(raw), 0, 0, get_imm_j(raw)};
+        case OPC_SYSTEM:   return decode_system(raw);
+        default:           return {opcode::UNIMP, 0, 0, 0, 0};
+    }
+}
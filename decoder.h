@@ -0,0 +1,39 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef DECODER_H
+#define DECODER_H
+#include <cstddef>
+#include <cstdint>
+
+#include "instruction.h"
+
+// RV32IMA machine code -> the same instruction form the assembler produces
+class decoder {
+    [[nodiscard]] static uint8_t    get_rd(uint32_t raw);
+    [[nodiscard]] static uint8_t    get_rs1(uint32_t raw);
+    [[nodiscard]] static uint8_t    get_rs2(uint32_t raw);
+    [[nodiscard]] static uint32_t   get_funct3(uint32_t raw);
+    [[nodiscard]] static uint32_t   get_funct7(uint32_t raw);
+    [[nodiscard]] static int32_t    sign_extend(uint32_t value, size_t bits);
+    [[nodiscard]] static int32_t    get_imm_i(uint32_t raw);
+    [[nodiscard]] static int32_t    get_imm_s(uint32_t raw);
+    [[nodiscard]] static int32_t    get_imm_b(uint32_t raw);
+    [[nodiscard]] static int32_t    get_imm_u(uint32_t raw);
+    [[nodiscard]] static int32_t    get_imm_j(uint32_t raw);
+
+    [[nodiscard]] static instruction decode_load(uint32_t raw);
+    [[nodiscard]] static instruction decode_store(uint32_t raw);
+    [[nodiscard]] static instruction decode_branch(uint32_t raw);
+    [[nodiscard]] static instruction decode_op_imm(uint32_t raw);
+    [[nodiscard]] static instruction decode_op(uint32_t raw);
+    [[nodiscard]] static instruction decode_amo(uint32_t raw);
+    [[nodiscard]] static instruction decode_misc_mem(uint32_t raw);
+    [[nodiscard]] static instruction decode_system(uint32_t raw);
+public:
+    // unknown encodings become opcode::UNIMP and trap only if they are executed
+    [[nodiscard]] static instruction decode(uint32_t raw);
+};
+
+#endif //DECODER_H
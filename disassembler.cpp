@@ -0,0 +1,112 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "disassembler.h"
+#include "isa.h"
+
+// the names the assembler reads, the sink slot is x0 again
+static constexpr std::array<std::string_view, REGISTER_SLOTS> REGISTER_NAMES = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    "zero"
+};
+
+static std::string reg(const uint8_t index) {
+    return std::string(REGISTER_NAMES[index]);
+}
+
+static std::string address(const uint32_t addr) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << addr;
+    return oss.str();
+}
+
+disassembler::disassembler(const program &prog) : _prog(prog) {
+    for (const auto &[name, addr] : prog.symbols) {
+        const auto [it, inserted] = _targets.emplace(addr, name);
+        if (!inserted && name < it->second) it->second = name;
+    }
+}
+
+std::string disassembler::target(const size_t index, const int32_t offset) const {
+    const uint32_t addr = _prog.base + static_cast<uint32_t>(index * 4) + offset;
+    const auto it = _targets.find(addr);
+    return it == _targets.end() ? address(addr) : it->second;
+}
+
+std::string disassembler::line(const size_t index) const {
+    // a fused slot reads as the instruction it replaced, print() lists the second half next
+    instruction in = _prog.code[index];
+    if (format_of(in.op) == operands::FUSED) in.op = first_half(in.op);
+    const std::string op(mnemonic(in.op));
+    const std::string imm = std::to_string(in.imm);
+
+    switch (format_of(in.op)) {
+        case operands::NONE:
+        case operands::IGNORED:
+        case operands::FUSED:
+            return op;
+        case operands::TARGET:
+            return op + " " + target(index, in.imm);
+        case operands::RS1:
+            return op + " " + reg(in.rs1);
+        case operands::RD_RS1:
+            return op + " " + reg(in.rd) + ", " + reg(in.rs1);
+        case operands::RD_IMM12:
+        case operands::RD_IMM20:
+            return op + " " + reg(in.rd) + ", " + imm;
+        case operands::RD_CSR:
+            return op + " " + reg(in.rd) + ", " + (in.imm == CSR_MHARTID ? std::string("mhartid") : imm);
+        case operands::LOAD:
+            return op + " " + reg(in.rd) + ", " + imm + "(" + reg(in.rs1) + ")";
+        case operands::STORE:
+            return op + " " + reg(in.rs2) + ", " + imm + "(" + reg(in.rs1) + ")";
+        case operands::RD_RS1_RS2:
+            return op + " " + reg(in.rd) + ", " + reg(in.rs1) + ", " + reg(in.rs2);
+        case operands::RD_RS1_IMM12:
+        case operands::RD_RS1_SHAMT:
+            return op + " " + reg(in.rd) + ", " + reg(in.rs1) + ", " + imm;
+        // aliases never name a row, a decoded branch always has both registers
+        case operands::RS1_TARGET:
+        case operands::RS1_TARGET_SWAPPED:
+        case operands::RS1_RS2_TARGET:
+            return op + " " + reg(in.rs1) + ", " + reg(in.rs2) + ", " + target(index, in.imm);
+        case operands::JAL:
+            return op + " " + reg(in.rd) + ", " + target(index, in.imm);
+        case operands::JALR:
+            return op + " " + reg(in.rd) + ", " + imm + "(" + reg(in.rs1) + ")";
+        case operands::LR:
+            return op + " " + reg(in.rd) + ", (" + reg(in.rs1) + ")";
+        case operands::AMO:
+            return op + " " + reg(in.rd) + ", " + reg(in.rs2) + ", (" + reg(in.rs1) + ")";
+    }
+    return op;
+}
+
+void disassembler::print(std::ostream &out) const {
+    std::unordered_map<uint32_t, std::vector<std::string_view>> labels;
+    for (const auto &[name, addr] : _prog.symbols) labels[addr].push_back(name);
+    for (auto &[addr, names] : labels) std::sort(names.begin(), names.end());
+
+    for (size_t i = 0; i < _prog.code.size(); ++i) {
+        const uint32_t addr = _prog.base + static_cast<uint32_t>(i * 4);
+        if (const auto it = labels.find(addr); it != labels.end())
+            for (const std::string_view name : it->second) out << name << ":\n";
+
+        out << "    " << std::left << std::setw(36) << std::setfill(' ') << line(i) << "# " << address(addr);
+        if (const opcode op = _prog.code[i].op; format_of(op) == operands::FUSED) out << " " << mnemonic(op);
+        out << "\n";
+    }
+
+    // a label on the last line of the source points just past the code
+    if (const auto it = labels.find(_prog.base + static_cast<uint32_t>(_prog.code.size() * 4)); it != labels.end())
+        for (const std::string_view name : it->second) out << name << ":\n";
+}
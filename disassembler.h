@@ -0,0 +1,32 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "instruction.h"
+
+// decoded code back to assembler syntax, the operands are laid out by the opcode's
+// row of ISA. targets with a label are written by name, so the listing of an
+// assembled program assembles to the same code. a fused pair is listed as the two
+// instructions it was made from, the first one's comment names the pair
+class disassembler {
+    const program&                                  _prog;
+    std::unordered_map<uint32_t, std::string>       _targets; // address -> the first of its labels by name
+
+    [[nodiscard]] std::string   target(size_t index, int32_t offset) const;
+public:
+    explicit disassembler(const program& prog);
+
+    [[nodiscard]] std::string   line(size_t index) const;
+    // every instruction with its address in a comment, labels on lines of their own
+    void                        print(std::ostream& out) const;
+};
+
+#endif //DISASSEMBLER_H
@@ -0,0 +1,53 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include "cpu.h"
+#include "fusion.h"
+
+bool fusion::fusable(const instruction &first, const instruction &second, opcode &fused) {
+    // 32 bit constant, both halves build the same register
+    if (first.op == opcode::LUI && second.op == opcode::ADDI && second.rd == first.rd && second.rs1 == first.rd) {
+        fused = opcode::LUI_ADDI;
+        return true;
+    }
+
+    // compare and branch on the flag, a flag in x0 has rd == SINK and never matches
+    if (first.op == opcode::SLT && second.op == opcode::BNE && second.rs1 == first.rd && second.rs2 == ZERO) {
+        fused = opcode::SLT_BNEZ;
+        return true;
+    }
+
+    // far call or jump through the pc relative base
+    if (first.op == opcode::AUIPC && second.op == opcode::JALR && second.rs1 == first.rd) {
+        fused = opcode::AUIPC_JALR;
+        return true;
+    }
+
+    // loop back edge, counter update and test
+    if (first.op == opcode::ADDI && second.op == opcode::BNE) {
+        fused = opcode::ADDI_BNE;
+        return true;
+    }
+
+    return false;
+}
+
+std::array<uint64_t, FUSED_COUNT> fusion::run(program &prog) {
+    std::array<uint64_t, FUSED_COUNT> sites = {};
+    auto &code = prog.code;
+
+    // the second half is skipped so it is never the first half of another pair,
+    // fused handlers read it back from the next slot
+    for (size_t i = 0; i + 1 < code.size(); ++i) {
+        opcode fused;
+        if (!fusable(code[i], code[i + 1], fused)) continue;
+
+        code[i].op = fused;
+        ++sites[kind(fused)];
+        ++i;
+    }
+
+    prog.generation = next_program_generation();
+    return sites;
+}
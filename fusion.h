@@ -0,0 +1,28 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef FUSION_H
+#define FUSION_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "instruction.h"
+#include "isa.h"
+
+// peephole pass over decoded code, frequent pairs become one superinstruction
+// that is dispatched once and leaves pc 8 bytes further or at the branch target
+class fusion {
+    [[nodiscard]] static bool   fusable(const instruction& first, const instruction& second, opcode& fused);
+public:
+    // rewrites prog.code in place, returns how many pairs of each kind were fused
+    static std::array<uint64_t, FUSED_COUNT> run(program& prog);
+
+    // index into the counters of a fused opcode
+    [[nodiscard]] static size_t kind(const opcode op) { return static_cast<size_t>(op) - INSTRUCTIONS_COUNT; }
+    [[nodiscard]] static std::string_view name(const size_t kind) { return mnemonic(static_cast<opcode>(INSTRUCTIONS_COUNT + kind)); }
+};
+
+#endif //FUSION_H
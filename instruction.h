@@ -0,0 +1,166 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef INSTRUCTION_H
+#define INSTRUCTION_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// same order as ISA in isa.h
+enum class opcode : uint8_t {
+    RET,
+    NOP,
+    ECALL,
+    EBREAK,
+    J,
+    CALL,
+    TAIL,
+    LB,
+    LH,
+    LW,
+    LBU,
+    LHU,
+    SB,
+    SH,
+    SW,
+    LI,
+    LUI,
+    AUIPC,
+    MV,
+    SEXT_W,
+    NEG,
+    NEGW,
+    SEQZ,
+    SNEZ,
+    NOT,
+    JAL,
+    JR,
+    SLTZ,
+    SGTZ,
+    ADDI,
+    ADD,
+    SUBI,
+    SUB,
+    XORI,
+    XOR,
+    ORI,
+    OR,
+    ANDI,
+    AND,
+    SLLI,
+    SLL,
+    SRA,
+    SRLI,
+    SRL,
+    SLTI,
+    SLT,
+    SLTIU,
+    SLTU,
+    BEQ,
+    BNE,
+    BLT,
+    BGE,
+    BLTU,
+    BGEU,
+    JALR,
+    MUL,
+    MULH,
+    MULSU,
+    MULU,
+    DIV,
+    DIVU,
+    REM,
+    REMU,
+    BGT,
+    BLE,
+    BGTU,
+    BLEU,
+    SRAI,
+    MULHU,
+    UNIMP,
+
+    // A extension, word sized only, plus the fence and the one csr read harts need
+    LR_W,
+    SC_W,
+    AMOSWAP_W,
+    AMOADD_W,
+    AMOXOR_W,
+    AMOAND_W,
+    AMOOR_W,
+    AMOMIN_W,
+    AMOMAX_W,
+    AMOMINU_W,
+    AMOMAXU_W,
+    FENCE,
+    CSRR,
+
+    // superinstructions written by fusion::run, never assembled. the second
+    // half of the pair is left untouched in the next slot
+    LUI_ADDI,
+    SLT_BNEZ,
+    AUIPC_JALR,
+    ADDI_BNE
+};
+
+// counted off the enum, the fused opcodes are the last ones
+constexpr size_t INSTRUCTIONS_COUNT = static_cast<size_t>(opcode::LUI_ADDI);
+constexpr size_t OPCODES_COUNT = static_cast<size_t>(opcode::ADDI_BNE) + 1;
+constexpr size_t FUSED_COUNT = OPCODES_COUNT - INSTRUCTIONS_COUNT;
+
+// x0 plus the 31 general purpose registers and a slot nobody reads, instructions
+// that write x0 write there instead so the handlers need no branch
+constexpr size_t  REGISTER_SLOTS = 33;
+constexpr uint8_t SINK = 32;
+
+constexpr int32_t CSR_MHARTID = 0xf14; // csrr keeps the csr number in imm
+
+// registers are range checked and immediates are validated at decode time,
+// the executor trusts every field
+struct instruction {
+    opcode  op;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;
+};
+static_assert(sizeof(instruction) == 8, "instruction must stay 8 bytes");
+
+// applied to everything that goes into program::code
+[[nodiscard]] constexpr instruction sink_x0(instruction in) {
+    if (in.rd == 0) in.rd = SINK;
+    return in;
+}
+
+// loadable piece of a binary image, bytes past bytes.size() up to size are zero
+struct segment {
+    uint32_t             address;
+    uint32_t             size;
+    std::vector<uint8_t> bytes;
+};
+
+// a fresh value for every program made and every rewrite of one, never 0
+[[nodiscard]] inline uint64_t next_program_generation() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// branch and jump immediates are byte offsets relative to the instruction, like the real encoding
+struct program {
+    uint32_t                 base = 0;  // address of code[0]
+    uint32_t                 entry = 0; // first pc
+    std::vector<instruction> code;
+    std::vector<uint64_t>    lines; // source line of code[i], empty for binaries
+    std::unordered_map<std::string, uint32_t> symbols; // label -> address
+    std::vector<segment>     segments;
+    // caches built from the code compare it besides the address, so a program assigned
+    // over or rewritten in place is not mistaken for the old one. whoever changes code
+    // after it was run takes a new one
+    uint64_t                 generation = next_program_generation();
+};
+
+#endif //INSTRUCTION_H
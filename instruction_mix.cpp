@@ -0,0 +1,76 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "instruction_mix.h"
+#include "isa.h"
+
+bool instruction_mix::is_branch(const opcode op) {
+    switch (op) {
+        case opcode::BEQ:
+        case opcode::BNE:
+        case opcode::BLT:
+        case opcode::BGE:
+        case opcode::BLTU:
+        case opcode::BGEU:
+        case opcode::BGT:
+        case opcode::BLE:
+        case opcode::BGTU:
+        case opcode::BLEU:
+        case opcode::SLT_BNEZ:
+        case opcode::ADDI_BNE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void instruction_mix::clear() {
+    _retired.fill(0);
+    _taken.fill(0);
+}
+
+static std::string name_of(const size_t op) {
+    return std::string(mnemonic(static_cast<opcode>(op)));
+}
+
+static double percent(const uint64_t part, const uint64_t whole) {
+    return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+void instruction_mix::print() const {
+    const uint64_t total = std::accumulate(_retired.begin(), _retired.end(), uint64_t{0});
+
+    std::vector<size_t> order;
+    for (size_t op = 0; op < OPCODES_COUNT; ++op)
+        if (_retired[op]) order.push_back(op);
+    std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return _retired[a] > _retired[b]; });
+
+    std::cout << "---------- Instruction mix ----------\n";
+    for (const size_t op : order)
+        std::cout << std::left << std::setw(12) << std::setfill(' ') << name_of(op) << std::right << std::setw(14) << _retired[op]
+                  << std::setw(9) << std::fixed << std::setprecision(2) << percent(_retired[op], total) << "%\n";
+    std::cout << std::left << std::setw(12) << "total" << std::right << std::setw(14) << total << "\n";
+
+    uint64_t branches = 0, taken = 0;
+    for (size_t op = 0; op < OPCODES_COUNT; ++op) {
+        if (!is_branch(static_cast<opcode>(op))) continue;
+        branches += _retired[op];
+        taken += _taken[op];
+    }
+    std::cout << "branches: " << taken << " taken (" << percent(taken, branches) << "%), "
+              << branches - taken << " not taken\n";
+
+    const auto count = [&](const opcode op) { return _retired[static_cast<size_t>(op)]; };
+    std::cout << "loads:  " << count(opcode::LB) + count(opcode::LBU) << " x 1, " << count(opcode::LH) + count(opcode::LHU)
+              << " x 2, " << count(opcode::LW) << " x 4 bytes\n";
+    std::cout << "stores: " << count(opcode::SB) << " x 1, " << count(opcode::SH) << " x 2, " << count(opcode::SW) << " x 4 bytes\n";
+    std::cout << std::endl;
+}
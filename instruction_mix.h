@@ -0,0 +1,49 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef INSTRUCTION_MIX_H
+#define INSTRUCTION_MIX_H
+#include <array>
+#include <cstdint>
+
+#include "instruction.h"
+#include "isa.h"
+
+// retirements per opcode and branch outcomes, the cpu only keeps one when built
+// with RISCV_COUNTERS so the engines pay nothing otherwise
+class instruction_mix {
+    std::array<uint64_t, OPCODES_COUNT> _retired = {};
+    std::array<uint64_t, OPCODES_COUNT> _taken = {};
+public:
+    [[nodiscard]] static bool is_branch(opcode op);
+
+    // in points into program::code, a superinstruction retires both instructions it
+    // replaced and its second half is the next slot. the totals match an unfused run
+    void retire(const instruction& in) {
+        if (in.op < opcode::LUI_ADDI) {
+            ++_retired[static_cast<size_t>(in.op)];
+            return;
+        }
+        ++_retired[static_cast<size_t>(first_half(in.op))];
+        ++_retired[static_cast<size_t>((&in)[1].op)];
+    }
+
+    // next_pc is where the branch at pc sent control, superinstructions fall through 8 bytes
+    // and their outcome belongs to the branch in the second half
+    void branch(const instruction& in, const uint32_t pc, const uint32_t next_pc) {
+        if (!is_branch(in.op)) return;
+
+        const bool fused = in.op >= opcode::LUI_ADDI;
+        if (next_pc != pc + (fused ? 8 : 4)) ++_taken[static_cast<size_t>(fused ? (&in)[1].op : in.op)];
+    }
+
+    [[nodiscard]] uint64_t retired(const opcode op) const { return _retired[static_cast<size_t>(op)]; }
+    [[nodiscard]] uint64_t taken(const opcode op) const { return _taken[static_cast<size_t>(op)]; }
+    void                   clear();
+
+    // sorted by frequency, followed by branch outcomes and memory accesses by width
+    void                   print() const;
+};
+
+#endif //INSTRUCTION_MIX_H
@@ -0,0 +1,258 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef ISA_H
+#define ISA_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "instruction.h"
+
+// how the assembler reads the operands of a mnemonic and the disassembler writes them
+enum class operands : uint8_t {
+    NONE,               // ret
+    IGNORED,            // ecall, anything after the mnemonic is dropped
+    TARGET,             // j label
+    RS1,                // jr rs1
+    RD_RS1,             // mv rd, rs1
+    RD_IMM12,           // li rd, imm
+    RD_IMM20,           // lui rd, imm
+    RD_CSR,             // csrr rd, csr
+    RS1_TARGET,         // beqz rs1, label
+    RS1_TARGET_SWAPPED, // blez rs1, label, the register goes to rs2
+    LOAD,               // lw rd, imm(rs1)
+    STORE,              // sw rs2, imm(rs1)
+    RD_RS1_RS2,         // add rd, rs1, rs2
+    RD_RS1_IMM12,       // addi rd, rs1, imm
+    RD_RS1_SHAMT,       // slli rd, rs1, shamt
+    RS1_RS2_TARGET,     // beq rs1, rs2, label
+    JAL,                // jal label or jal rd, label
+    JALR,               // jalr rs1, jalr rd, imm(rs1) or jalr rd, rs1, imm
+    LR,                 // lr.w rd, (rs1)
+    AMO,                // amoadd.w rd, rs2, (rs1)
+    FUSED               // written by fusion, never assembled
+};
+
+// how control leaves an instruction, the threaded engine picks each handler's tail from it
+enum class flow : uint8_t {
+    NEXT,       // falls through and cannot trap
+    CHECKED,    // falls through unless it trapped
+    JUMP,       // leaves the next pc in _next_pc
+    STOP,       // always traps
+    PAIR        // falls through past the second half of its pair
+};
+
+// one row per opcode in enum order. the semantics are cpu::exec<op>, the engines
+// build their dispatch from this table and the assembler its mnemonic lookup
+struct isa_entry {
+    opcode              op;
+    std::string_view    mnemonic;
+    operands            format;
+    flow                exit;
+};
+
+constexpr std::array<isa_entry, OPCODES_COUNT> ISA = {{
+    {opcode::RET,        "ret",        operands::NONE,           flow::JUMP},
+    {opcode::NOP,        "nop",        operands::NONE,           flow::NEXT},
+    {opcode::ECALL,      "ecall",      operands::IGNORED,        flow::CHECKED},
+    {opcode::EBREAK,     "ebreak",     operands::IGNORED,        flow::STOP},
+    {opcode::J,          "j",          operands::TARGET,         flow::JUMP},
+    {opcode::CALL,       "call",       operands::TARGET,         flow::JUMP},
+    {opcode::TAIL,       "tail",       operands::TARGET,         flow::JUMP},
+    {opcode::LB,         "lb",         operands::LOAD,           flow::CHECKED},
+    {opcode::LH,         "lh",         operands::LOAD,           flow::CHECKED},
+    {opcode::LW,         "lw",         operands::LOAD,           flow::CHECKED},
+    {opcode::LBU,        "lbu",        operands::LOAD,           flow::CHECKED},
+    {opcode::LHU,        "lhu",        operands::LOAD,           flow::CHECKED},
+    {opcode::SB,         "sb",         operands::STORE,          flow::CHECKED},
+    {opcode::SH,         "sh",         operands::STORE,          flow::CHECKED},
+    {opcode::SW,         "sw",         operands::STORE,          flow::CHECKED},
+    {opcode::LI,         "li",         operands::RD_IMM12,       flow::NEXT},
+    {opcode::LUI,        "lui",        operands::RD_IMM20,       flow::NEXT},
+    {opcode::AUIPC,      "auipc",      operands::RD_IMM20,       flow::NEXT},
+    {opcode::MV,         "mv",         operands::RD_RS1,         flow::NEXT},
+    {opcode::SEXT_W,     "sext.w",     operands::RD_RS1,         flow::NEXT},
+    {opcode::NEG,        "neg",        operands::RD_RS1,         flow::NEXT},
+    {opcode::NEGW,       "negw",       operands::RD_RS1,         flow::NEXT},
+    {opcode::SEQZ,       "seqz",       operands::RD_RS1,         flow::NEXT},
+    {opcode::SNEZ,       "snez",       operands::RD_RS1,         flow::NEXT},
+    {opcode::NOT,        "not",        operands::RD_RS1,         flow::NEXT},
+    {opcode::JAL,        "jal",        operands::JAL,            flow::JUMP},
+    {opcode::JR,         "jr",         operands::RS1,            flow::JUMP},
+    {opcode::SLTZ,       "sltz",       operands::RD_RS1,         flow::NEXT},
+    {opcode::SGTZ,       "sgtz",       operands::RD_RS1,         flow::NEXT},
+    {opcode::ADDI,       "addi",       operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::ADD,        "add",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SUBI,       "subi",       operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::SUB,        "sub",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::XORI,       "xori",       operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::XOR,        "xor",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::ORI,        "ori",        operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::OR,         "or",         operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::ANDI,       "andi",       operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::AND,        "and",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SLLI,       "slli",       operands::RD_RS1_SHAMT,   flow::NEXT},
+    {opcode::SLL,        "sll",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SRA,        "sra",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SRLI,       "srli",       operands::RD_RS1_SHAMT,   flow::NEXT},
+    {opcode::SRL,        "srl",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SLTI,       "slti",       operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::SLT,        "slt",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::SLTIU,      "sltiu",      operands::RD_RS1_IMM12,   flow::NEXT},
+    {opcode::SLTU,       "sltu",       operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::BEQ,        "beq",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BNE,        "bne",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BLT,        "blt",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BGE,        "bge",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BLTU,       "bltu",       operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BGEU,       "bgeu",       operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::JALR,       "jalr",       operands::JALR,           flow::JUMP},
+    {opcode::MUL,        "mul",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::MULH,       "mulh",       operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::MULSU,      "mulsu",      operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::MULU,       "mulu",       operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::DIV,        "div",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::DIVU,       "divu",       operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::REM,        "rem",        operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::REMU,       "remu",       operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::BGT,        "bgt",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BLE,        "ble",        operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BGTU,       "bgtu",       operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::BLEU,       "bleu",       operands::RS1_RS2_TARGET, flow::JUMP},
+    {opcode::SRAI,       "srai",       operands::RD_RS1_SHAMT,   flow::NEXT},
+    {opcode::MULHU,      "mulhu",      operands::RD_RS1_RS2,     flow::NEXT},
+    {opcode::UNIMP,      "unimp",      operands::NONE,           flow::STOP},
+    {opcode::LR_W,       "lr.w",       operands::LR,             flow::CHECKED},
+    {opcode::SC_W,       "sc.w",       operands::AMO,            flow::CHECKED},
+    {opcode::AMOSWAP_W,  "amoswap.w",  operands::AMO,            flow::CHECKED},
+    {opcode::AMOADD_W,   "amoadd.w",   operands::AMO,            flow::CHECKED},
+    {opcode::AMOXOR_W,   "amoxor.w",   operands::AMO,            flow::CHECKED},
+    {opcode::AMOAND_W,   "amoand.w",   operands::AMO,            flow::CHECKED},
+    {opcode::AMOOR_W,    "amoor.w",    operands::AMO,            flow::CHECKED},
+    {opcode::AMOMIN_W,   "amomin.w",   operands::AMO,            flow::CHECKED},
+    {opcode::AMOMAX_W,   "amomax.w",   operands::AMO,            flow::CHECKED},
+    {opcode::AMOMINU_W,  "amominu.w",  operands::AMO,            flow::CHECKED},
+    {opcode::AMOMAXU_W,  "amomaxu.w",  operands::AMO,            flow::CHECKED},
+    {opcode::FENCE,      "fence",      operands::IGNORED,        flow::NEXT},
+    {opcode::CSRR,       "csrr",       operands::RD_CSR,         flow::CHECKED},
+    {opcode::LUI_ADDI,   "lui+addi",   operands::FUSED,          flow::PAIR},
+    {opcode::SLT_BNEZ,   "slt+bnez",   operands::FUSED,          flow::JUMP},
+    {opcode::AUIPC_JALR, "auipc+jalr", operands::FUSED,          flow::JUMP},
+    {opcode::ADDI_BNE,   "addi+bne",   operands::FUSED,          flow::JUMP},
+}};
+
+// spellings the assembler accepts on top of the table, they assemble to an existing opcode
+struct isa_syntax {
+    std::string_view    mnemonic;
+    opcode              op;
+    operands            format;
+};
+
+constexpr std::array<isa_syntax, 7> ISA_ALIASES = {{
+    {"beqz",   opcode::BEQ,   operands::RS1_TARGET},
+    {"bnez",   opcode::BNE,   operands::RS1_TARGET},
+    {"bltz",   opcode::BLT,   operands::RS1_TARGET},
+    {"bgez",   opcode::BGE,   operands::RS1_TARGET},
+    {"blez",   opcode::BGE,   operands::RS1_TARGET_SWAPPED},
+    {"bgtz",   opcode::BLT,   operands::RS1_TARGET_SWAPPED},
+    {"mulhsu", opcode::MULSU, operands::RD_RS1_RS2},
+}};
+
+[[nodiscard]] constexpr bool isa_rows_in_order() {
+    for (size_t i = 0; i < ISA.size(); ++i)
+        if (static_cast<size_t>(ISA[i].op) != i || ISA[i].mnemonic.empty()) return false;
+    for (size_t i = 0; i < ISA.size(); ++i)
+        if ((ISA[i].format == operands::FUSED) != (i >= INSTRUCTIONS_COUNT)) return false;
+    return true;
+}
+static_assert(isa_rows_in_order(), "ISA must have one row per opcode in enum order, fused ones last");
+
+[[nodiscard]] constexpr std::string_view mnemonic(const opcode op) { return ISA[static_cast<size_t>(op)].mnemonic; }
+[[nodiscard]] constexpr operands format_of(const opcode op) { return ISA[static_cast<size_t>(op)].format; }
+[[nodiscard]] constexpr flow flow_of(const opcode op) { return ISA[static_cast<size_t>(op)].exit; }
+
+// everything the assembler accepts: the table's rows without the fused ones, then the aliases
+constexpr std::array<isa_syntax, INSTRUCTIONS_COUNT + ISA_ALIASES.size()> ISA_SYNTAX = [] {
+    std::array<isa_syntax, INSTRUCTIONS_COUNT + ISA_ALIASES.size()> syntax = {};
+    for (size_t i = 0; i < INSTRUCTIONS_COUNT; ++i) syntax[i] = {ISA[i].mnemonic, ISA[i].op, ISA[i].format};
+    for (size_t i = 0; i < ISA_ALIASES.size(); ++i) syntax[INSTRUCTIONS_COUNT + i] = ISA_ALIASES[i];
+    return syntax;
+}();
+
+[[nodiscard]] constexpr bool isa_mnemonics_unique() {
+    for (size_t i = 0; i < ISA_SYNTAX.size(); ++i)
+        for (size_t j = i + 1; j < ISA_SYNTAX.size(); ++j)
+            if (ISA_SYNTAX[i].mnemonic == ISA_SYNTAX[j].mnemonic) return false;
+    return true;
+}
+static_assert(isa_mnemonics_unique(), "a mnemonic is spelled twice in ISA or ISA_ALIASES");
+
+// perfect hash of the mnemonics: fnv-1a from a seed searched at compile time, the top
+// bits pick a slot and no two mnemonics share one. a lookup is one hash, one load and
+// one compare, the compare rejects everything that is not a mnemonic
+constexpr unsigned MNEMONIC_HASH_BITS = 10;
+constexpr size_t   MNEMONIC_SLOTS = size_t{1} << MNEMONIC_HASH_BITS;
+static_assert(ISA_SYNTAX.size() < 0xff, "mnemonic slots hold a uint8_t index");
+
+[[nodiscard]] constexpr uint32_t mnemonic_hash(const std::string_view s, const uint32_t seed) {
+    uint32_t h = seed;
+    for (const char c : s) h = (h ^ static_cast<uint8_t>(c)) * 0x01000193;
+    return h >> (32 - MNEMONIC_HASH_BITS);
+}
+
+// 0 when every seed tried has a collision
+constexpr uint32_t MNEMONIC_SEED = [] {
+    if (!isa_mnemonics_unique()) return uint32_t{0};
+    for (uint32_t seed = 0x811c9dc5; seed != 0x811c9dc5 + 4096; ++seed) {
+        std::array<bool, MNEMONIC_SLOTS> used = {};
+        bool collision = false;
+        for (const isa_syntax &s : ISA_SYNTAX) {
+            bool &slot = used[mnemonic_hash(s.mnemonic, seed)];
+            collision = collision || slot;
+            slot = true;
+        }
+        if (!collision) return seed;
+    }
+    return uint32_t{0};
+}();
+static_assert(MNEMONIC_SEED != 0, "no seed separates the mnemonics, raise MNEMONIC_HASH_BITS");
+
+// index + 1 into ISA_SYNTAX, 0 for an empty slot
+constexpr std::array<uint8_t, MNEMONIC_SLOTS> MNEMONIC_TABLE = [] {
+    std::array<uint8_t, MNEMONIC_SLOTS> table = {};
+    for (size_t i = 0; i < ISA_SYNTAX.size(); ++i)
+        table[mnemonic_hash(ISA_SYNTAX[i].mnemonic, MNEMONIC_SEED)] = static_cast<uint8_t>(i + 1);
+    return table;
+}();
+
+// nullptr for anything that is not a mnemonic
+[[nodiscard]] constexpr const isa_syntax* find_mnemonic(const std::string_view s) {
+    const uint8_t slot = MNEMONIC_TABLE[mnemonic_hash(s, MNEMONIC_SEED)];
+    if (slot == 0 || ISA_SYNTAX[slot - 1].mnemonic != s) return nullptr;
+    return &ISA_SYNTAX[slot - 1];
+}
+static_assert(find_mnemonic("addi")->op == opcode::ADDI && find_mnemonic("bgtz")->op == opcode::BLT &&
+              !find_mnemonic("lui+addi") && !find_mnemonic("addii"), "mnemonic lookup is broken");
+
+// the plain opcode a superinstruction replaced, named before the + of its mnemonic. the
+// fused slot keeps that instruction's fields, the second half is the next slot
+[[nodiscard]] constexpr opcode first_half(const opcode op) {
+    const std::string_view name = mnemonic(op);
+    return find_mnemonic(name.substr(0, name.find('+')))->op;
+}
+
+constexpr bool fused_halves_named() {
+    for (size_t i = INSTRUCTIONS_COUNT; i < OPCODES_COUNT; ++i) {
+        const std::string_view name = ISA[i].mnemonic;
+        const size_t plus = name.find('+');
+        if (plus == std::string_view::npos || !find_mnemonic(name.substr(0, plus)) || !find_mnemonic(name.substr(plus + 1)))
+            return false;
+    }
+    return true;
+}
+static_assert(fused_halves_named(), "a fused mnemonic must be first+second, both of them mnemonics");
+
+#endif //ISA_H
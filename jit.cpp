@@ -0,0 +1,503 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "jit.h"
+
+// host register numbers, rdi holds the guest register file for the whole block.
+// rax and rcx carry operands, rdx is clobbered by div
+constexpr uint8_t RAX = 0;
+constexpr uint8_t RCX = 1;
+constexpr uint8_t RDX = 2;
+constexpr uint8_t RBX = 3;
+constexpr uint8_t RSI = 6;
+constexpr uint8_t RDI = 7;
+constexpr uint8_t R8 = 8;
+constexpr uint8_t R9 = 9;
+constexpr uint8_t R10 = 10;
+constexpr uint8_t R11 = 11;
+constexpr uint8_t R12 = 12;
+constexpr uint8_t R13 = 13;
+constexpr uint8_t R14 = 14;
+constexpr uint8_t R15 = 15;
+
+// guest registers are cached in these, the callee saved ones are pushed when used
+constexpr std::array<uint8_t, 10> CACHE_REGISTERS = { RSI, R8, R9, R10, R11, RBX, R12, R13, R14, R15 };
+
+// op r/m32, r32
+constexpr uint8_t OP_ADD = 0x01;
+constexpr uint8_t OP_OR = 0x09;
+constexpr uint8_t OP_AND = 0x21;
+constexpr uint8_t OP_SUB = 0x29;
+constexpr uint8_t OP_XOR = 0x31;
+constexpr uint8_t OP_CMP = 0x39;
+constexpr uint8_t OP_TEST = 0x85;
+
+// reg field of the 0x81 (imm32), 0xC1 (shift by imm8), 0xD3 (shift by cl) and 0xF7 groups
+constexpr uint8_t EXT_ADD = 0;
+constexpr uint8_t EXT_OR = 1;
+constexpr uint8_t EXT_AND = 4;
+constexpr uint8_t EXT_SUB = 5;
+constexpr uint8_t EXT_XOR = 6;
+constexpr uint8_t EXT_CMP = 7;
+constexpr uint8_t EXT_SHL = 4;
+constexpr uint8_t EXT_SHR = 5;
+constexpr uint8_t EXT_SAR = 7;
+constexpr uint8_t EXT_NOT = 2;
+constexpr uint8_t EXT_NEG = 3;
+
+// condition codes, JMP is not one and selects an unconditional jump
+constexpr uint8_t CC_B = 0x2;
+constexpr uint8_t CC_E = 0x4;
+constexpr uint8_t CC_NE = 0x5;
+constexpr uint8_t CC_L = 0xC;
+constexpr uint8_t JMP = 0xFF;
+
+static uint32_t slot(const size_t guest) {
+    return static_cast<uint32_t>(guest * sizeof(uint32_t));
+}
+
+static bool is_callee_saved(const uint8_t host) {
+    return host == RBX || host >= R12;
+}
+
+jit::~jit() {
+    if (_region) munmap(_region, JIT_REGION_SIZE);
+}
+jit::jit(jit &&other) noexcept :
+    _region(std::exchange(other._region, nullptr)), _used(std::exchange(other._used, 0)),
+    _failed(other._failed) {
+}
+jit &jit::operator=(jit &&other) noexcept {
+    if (this != &other) {
+        if (_region) munmap(_region, JIT_REGION_SIZE);
+        _region = std::exchange(other._region, nullptr);
+        _used = std::exchange(other._used, 0);
+        _failed = other._failed;
+    }
+    return *this;
+}
+
+void jit::reset() {
+    _used = 0;
+}
+
+bool jit::supported(const opcode op) {
+    switch (op) {
+        case opcode::NOP:
+        case opcode::LI:
+        case opcode::LUI:
+        case opcode::AUIPC:
+        case opcode::MV:
+        case opcode::SEXT_W:
+        case opcode::NEG:
+        case opcode::NEGW:
+        case opcode::SEQZ:
+        case opcode::SNEZ:
+        case opcode::NOT:
+        case opcode::SLTZ:
+        case opcode::SGTZ:
+        case opcode::ADDI:
+        case opcode::ADD:
+        case opcode::SUBI:
+        case opcode::SUB:
+        case opcode::XORI:
+        case opcode::XOR:
+        case opcode::ORI:
+        case opcode::OR:
+        case opcode::ANDI:
+        case opcode::AND:
+        case opcode::SLLI:
+        case opcode::SLL:
+        case opcode::SRA:
+        case opcode::SRLI:
+        case opcode::SRL:
+        case opcode::SRAI:
+        case opcode::SLTI:
+        case opcode::SLT:
+        case opcode::SLTIU:
+        case opcode::SLTU:
+        case opcode::MUL:
+        case opcode::MULH:
+        case opcode::MULSU:
+        case opcode::MULU:
+        case opcode::MULHU:
+        case opcode::DIV:
+        case opcode::DIVU:
+        case opcode::REM:
+        case opcode::REMU:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool jit::reserve() {
+    if (_region) return true;
+    if (_failed) return false;
+
+    // pages are only made executable once their code is written, see install()
+    void *region = mmap(nullptr, JIT_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        _failed = true;
+        return false;
+    }
+
+    _region = static_cast<uint8_t *>(region);
+    return true;
+}
+// the pages the code lands on are writable only while it is copied in, a page is never
+// writable and executable at once. hosts that refuse either switch keep interpreting
+uint8_t *jit::install() {
+    static const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    uint8_t *entry = _region + _used;
+    uint8_t *first = _region + (_used & ~(page - 1));
+    const size_t length = (entry + _code.size() - first + page - 1) & ~(page - 1);
+
+    if (mprotect(first, length, PROT_READ | PROT_WRITE) != 0) return nullptr;
+    std::memcpy(entry, _code.data(), _code.size());
+    if (mprotect(first, length, PROT_READ | PROT_EXEC) != 0) return nullptr;
+
+    _used = (_used + _code.size() + 15) & ~static_cast<size_t>(15);
+    return entry;
+}
+
+void jit::emit(const std::initializer_list<uint8_t> bytes) {
+    _code.insert(_code.end(), bytes);
+}
+void jit::emit_u32(const uint32_t value) {
+    emit({
+        static_cast<uint8_t>(value),
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 24)
+    });
+}
+void jit::emit_rex(const bool wide, const uint8_t reg, const uint8_t rm) {
+    const uint8_t rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40) emit({rex});
+}
+void jit::emit_modrm(const uint8_t mod, const uint8_t reg, const uint8_t rm) {
+    emit({static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7))});
+}
+void jit::emit_mov(const uint8_t dst, const uint8_t src) {
+    emit_alu(0x89, dst, src);
+}
+void jit::emit_mov_imm(const uint8_t dst, const uint32_t imm) {
+    emit_rex(false, 0, dst);
+    emit({static_cast<uint8_t>(0xB8 | (dst & 7))});
+    emit_u32(imm);
+}
+void jit::emit_load_slot(const uint8_t dst, const size_t guest) {
+    // mov dst, [rdi + disp32]
+    emit_rex(false, dst, RDI);
+    emit({0x8B});
+    emit_modrm(2, dst, RDI);
+    emit_u32(slot(guest));
+}
+void jit::emit_store_slot(const size_t guest, const uint8_t src) {
+    // mov [rdi + disp32], src
+    emit_rex(false, src, RDI);
+    emit({0x89});
+    emit_modrm(2, src, RDI);
+    emit_u32(slot(guest));
+}
+void jit::emit_alu(const uint8_t op, const uint8_t dst, const uint8_t src) {
+    emit_rex(false, src, dst);
+    emit({op});
+    emit_modrm(3, src, dst);
+}
+void jit::emit_alu_imm(const uint8_t ext, const uint8_t dst, const uint32_t imm) {
+    emit_rex(false, 0, dst);
+    emit({0x81});
+    emit_modrm(3, ext, dst);
+    emit_u32(imm);
+}
+void jit::emit_shift_imm(const uint8_t ext, const uint8_t dst, const uint8_t amount) {
+    emit_rex(false, 0, dst);
+    emit({0xC1});
+    emit_modrm(3, ext, dst);
+    emit({amount});
+}
+void jit::emit_setcc(const uint8_t cc) {
+    // setcc al, movzx eax, al
+    emit({0x0F, static_cast<uint8_t>(0x90 | cc), 0xC0, 0x0F, 0xB6, 0xC0});
+}
+size_t jit::emit_jcc(const uint8_t cc) {
+    // rel8 is filled in by patch(), snippets are far shorter than 127 bytes
+    emit({cc == JMP ? static_cast<uint8_t>(0xEB) : static_cast<uint8_t>(0x70 | cc), 0});
+    return _code.size() - 1;
+}
+void jit::patch(const size_t at) {
+    _code[at] = static_cast<uint8_t>(_code.size() - (at + 1));
+}
+
+void jit::read(const uint8_t dst, const size_t guest) {
+    if (guest == ZERO)
+        emit_alu(OP_XOR, dst, dst);
+    else if (_host[guest])
+        emit_mov(dst, _host[guest]);
+    else
+        emit_load_slot(dst, guest);
+}
+
+// the result is always in eax
+void jit::write(const size_t guest) {
+    if (guest == SINK) return;
+
+    if (_host[guest]) {
+        emit_mov(_host[guest], RAX);
+        _dirty |= 1ULL << guest;
+    } else {
+        emit_store_slot(guest, RAX);
+    }
+}
+
+void jit::emit_instruction(const instruction &in, const uint32_t pc) {
+    const auto imm = static_cast<uint32_t>(in.imm);
+
+    switch (in.op) {
+        case opcode::NOP:
+            return;
+        case opcode::LI:
+            emit_mov_imm(RAX, imm);
+            break;
+        case opcode::LUI:
+            emit_mov_imm(RAX, imm << 12);
+            break;
+        case opcode::AUIPC:
+            emit_mov_imm(RAX, pc + (imm << 12));
+            break;
+        // on rv32 the word forms are the plain ones
+        case opcode::MV:
+        case opcode::SEXT_W:
+            read(RAX, in.rs1);
+            break;
+        case opcode::NEG:
+        case opcode::NEGW:
+        case opcode::NOT:
+            read(RAX, in.rs1);
+            emit({0xF7});
+            emit_modrm(3, in.op == opcode::NOT ? EXT_NOT : EXT_NEG, RAX);
+            break;
+        case opcode::SEQZ:
+            read(RAX, in.rs1);
+            emit_alu_imm(EXT_CMP, RAX, 1);
+            emit_setcc(CC_B);
+            break;
+        case opcode::SNEZ:
+            read(RAX, in.rs1);
+            emit_alu(OP_TEST, RAX, RAX);
+            emit_setcc(CC_NE);
+            break;
+        case opcode::SLTZ:
+            read(RAX, in.rs1);
+            emit_shift_imm(EXT_SHR, RAX, 31);
+            break;
+        case opcode::SGTZ:
+            read(RCX, in.rs1);
+            emit_alu(OP_XOR, RAX, RAX);
+            emit_alu(OP_CMP, RAX, RCX);
+            emit_setcc(CC_L);
+            break;
+        case opcode::ADDI:
+        case opcode::SUBI:
+        case opcode::XORI:
+        case opcode::ORI:
+        case opcode::ANDI: {
+            read(RAX, in.rs1);
+            uint8_t ext = EXT_ADD;
+            if (in.op == opcode::SUBI) ext = EXT_SUB;
+            else if (in.op == opcode::XORI) ext = EXT_XOR;
+            else if (in.op == opcode::ORI) ext = EXT_OR;
+            else if (in.op == opcode::ANDI) ext = EXT_AND;
+            emit_alu_imm(ext, RAX, imm);
+            break;
+        }
+        case opcode::ADD:
+        case opcode::SUB:
+        case opcode::XOR:
+        case opcode::OR:
+        case opcode::AND: {
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            uint8_t op = OP_ADD;
+            if (in.op == opcode::SUB) op = OP_SUB;
+            else if (in.op == opcode::XOR) op = OP_XOR;
+            else if (in.op == opcode::OR) op = OP_OR;
+            else if (in.op == opcode::AND) op = OP_AND;
+            emit_alu(op, RAX, RCX);
+            break;
+        }
+        case opcode::SLLI:
+        case opcode::SRLI:
+        case opcode::SRAI:
+            read(RAX, in.rs1);
+            emit_shift_imm(in.op == opcode::SLLI ? EXT_SHL : in.op == opcode::SRLI ? EXT_SHR : EXT_SAR, RAX, imm & 0x1f);
+            break;
+        case opcode::SLL:
+        case opcode::SRL:
+        case opcode::SRA:
+            // the host masks the count in cl to 5 bits like the guest does
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            emit({0xD3});
+            emit_modrm(3, in.op == opcode::SLL ? EXT_SHL : in.op == opcode::SRL ? EXT_SHR : EXT_SAR, RAX);
+            break;
+        case opcode::SLTI:
+        case opcode::SLTIU:
+            read(RAX, in.rs1);
+            emit_alu_imm(EXT_CMP, RAX, imm);
+            emit_setcc(in.op == opcode::SLTI ? CC_L : CC_B);
+            break;
+        case opcode::SLT:
+        case opcode::SLTU:
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            emit_alu(OP_CMP, RAX, RCX);
+            emit_setcc(in.op == opcode::SLT ? CC_L : CC_B);
+            break;
+        case opcode::MUL:
+        case opcode::MULU:
+            // imul eax, ecx, the low half does not depend on signedness
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            emit({0x0F, 0xAF, 0xC1});
+            break;
+        case opcode::MULH:
+        case opcode::MULSU:
+        case opcode::MULHU:
+            // 32 bit moves zero extend, sign extend with movsxd where the operand is signed
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            if (in.op != opcode::MULHU) emit({0x48, 0x63, 0xC0});
+            if (in.op == opcode::MULH) emit({0x48, 0x63, 0xC9});
+            emit({0x48, 0x0F, 0xAF, 0xC1});
+            emit({0x48, 0xC1, static_cast<uint8_t>(in.op == opcode::MULHU ? 0xE8 : 0xF8), 32});
+            break;
+        case opcode::DIV:
+        case opcode::REM: {
+            const bool rem = in.op == opcode::REM;
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            emit_alu(OP_TEST, RCX, RCX);
+            const size_t by_zero = emit_jcc(CC_E);
+            emit_alu_imm(EXT_CMP, RCX, 0xFFFFFFFF);
+            const size_t divide = emit_jcc(CC_NE);
+            emit_alu_imm(EXT_CMP, RAX, 0x80000000);
+            const size_t overflow = emit_jcc(CC_E);
+
+            patch(divide);
+            emit({0x99, 0xF7, 0xF9}); // cdq, idiv ecx
+            if (rem) emit_mov(RAX, RDX);
+            const size_t done = emit_jcc(JMP);
+
+            // rem by zero leaves rs1 in eax, INT_MIN / -1 leaves INT_MIN
+            patch(by_zero);
+            if (!rem) emit_mov_imm(RAX, 0xFFFFFFFF);
+            if (rem) {
+                const size_t skip = emit_jcc(JMP);
+                patch(overflow);
+                emit_alu(OP_XOR, RAX, RAX);
+                patch(skip);
+            } else {
+                patch(overflow);
+            }
+            patch(done);
+            break;
+        }
+        case opcode::DIVU:
+        case opcode::REMU: {
+            read(RAX, in.rs1);
+            read(RCX, in.rs2);
+            emit_alu(OP_TEST, RCX, RCX);
+            const size_t by_zero = emit_jcc(CC_E);
+            emit_alu(OP_XOR, RDX, RDX);
+            emit({0xF7, 0xF1}); // div ecx
+            if (in.op == opcode::REMU) emit_mov(RAX, RDX);
+            const size_t done = emit_jcc(JMP);
+
+            patch(by_zero);
+            if (in.op == opcode::DIVU) emit_mov_imm(RAX, 0xFFFFFFFF);
+            patch(done);
+            break;
+        }
+        default:
+            return;
+    }
+
+    write(in.rd);
+}
+
+native_block jit::compile(const instruction *code, const uint32_t count, const uint32_t pc, uint32_t &compiled) {
+    compiled = 0;
+#if defined(__x86_64__)
+    uint32_t length = 0;
+    while (length < count && supported(code[length].op)) ++length;
+    if (length == 0 || !reserve()) return nullptr;
+
+    // the most used guest registers of the run get a host register each
+    std::array<uint32_t, REGISTER_SLOTS> uses = {};
+    for (uint32_t i = 0; i < length; ++i) {
+        ++uses[code[i].rd];
+        ++uses[code[i].rs1];
+        ++uses[code[i].rs2];
+    }
+    uses[ZERO] = 0;
+    uses[SINK] = 0;
+
+    std::array<uint8_t, REGISTER_SLOTS> order;
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint8_t>(i);
+    std::stable_sort(order.begin(), order.end(), [&](const uint8_t a, const uint8_t b) { return uses[a] > uses[b]; });
+
+    std::memset(_host, 0, sizeof(_host));
+    _dirty = 0;
+    _code.clear();
+
+    size_t cached = 0;
+    while (cached < CACHE_REGISTERS.size() && uses[order[cached]] > 0) {
+        _host[order[cached]] = CACHE_REGISTERS[cached];
+        ++cached;
+    }
+
+    for (size_t i = 0; i < cached; ++i) {
+        const uint8_t host = CACHE_REGISTERS[i];
+        if (!is_callee_saved(host)) continue;
+        emit_rex(false, 0, host);
+        emit({static_cast<uint8_t>(0x50 | (host & 7))}); // push
+    }
+    for (size_t i = 0; i < cached; ++i)
+        emit_load_slot(CACHE_REGISTERS[i], order[i]);
+
+    for (uint32_t i = 0; i < length; ++i)
+        emit_instruction(code[i], pc + i * 4);
+
+    for (size_t i = 0; i < cached; ++i)
+        if (_dirty & (1ULL << order[i])) emit_store_slot(order[i], CACHE_REGISTERS[i]);
+    for (size_t i = cached; i-- > 0;) {
+        const uint8_t host = CACHE_REGISTERS[i];
+        if (!is_callee_saved(host)) continue;
+        emit_rex(false, 0, host);
+        emit({static_cast<uint8_t>(0x58 | (host & 7))}); // pop
+    }
+    emit({0xC3}); // ret
+
+    // once the region is full the remaining blocks stay interpreted until reset()
+    if (_used + _code.size() > JIT_REGION_SIZE) return nullptr;
+
+    uint8_t *entry = install();
+    if (!entry) return nullptr;
+
+    compiled = length;
+    return reinterpret_cast<native_block>(entry);
+#else
+    return nullptr;
+#endif
+}
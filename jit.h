@@ -0,0 +1,77 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef JIT_H
+#define JIT_H
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "block_cache.h"
+#include "instruction.h"
+
+constexpr size_t   JIT_REGION_SIZE = 16 * 1024 * 1024;
+constexpr uint64_t JIT_THRESHOLD = 16; // block executions before it is compiled
+
+// template jit for x86-64, every supported opcode expands to a fixed snippet of host
+// code. on other hosts compile() always returns nullptr.
+//
+// only register to register ALU work is compiled, and only the leading run of it: the
+// native code stops at a block's first load, store, branch or other unsupported
+// instruction and the interpreter does the rest, ALU work after it included. a block
+// that starts with a load gets no native code at all, so memory heavy loops gain little.
+//
+// the code region is mapped read and write without exec, compiled code is copied in
+// and its pages switched to read and exec
+class jit {
+    uint8_t*                _region = nullptr;
+    size_t                  _used = 0;
+    bool                    _failed = false;
+    std::vector<uint8_t>    _code; // block being compiled
+
+    // guest register -> host register, 0 when it lives in memory
+    uint8_t                 _host[REGISTER_SLOTS] = {};
+    uint64_t                _dirty = 0;
+
+    [[nodiscard]] static bool supported(opcode op);
+    [[nodiscard]] bool      reserve();
+    [[nodiscard]] uint8_t*  install();
+
+    void    emit(std::initializer_list<uint8_t> bytes);
+    void    emit_u32(uint32_t value);
+    void    emit_rex(bool wide, uint8_t reg, uint8_t rm);
+    void    emit_modrm(uint8_t mod, uint8_t reg, uint8_t rm);
+    void    emit_mov(uint8_t dst, uint8_t src);
+    void    emit_mov_imm(uint8_t dst, uint32_t imm);
+    void    emit_load_slot(uint8_t dst, size_t guest);
+    void    emit_store_slot(size_t guest, uint8_t src);
+    void    emit_alu(uint8_t op, uint8_t dst, uint8_t src);
+    void    emit_alu_imm(uint8_t ext, uint8_t dst, uint32_t imm);
+    void    emit_shift_imm(uint8_t ext, uint8_t dst, uint8_t amount);
+    void    emit_setcc(uint8_t cc);
+    size_t  emit_jcc(uint8_t cc);
+    void    patch(size_t at);
+
+    void    read(uint8_t dst, size_t guest);
+    void    write(size_t guest);
+    void    emit_instruction(const instruction& in, uint32_t pc);
+public:
+    jit() = default;
+    ~jit();
+    jit(const jit&) = delete;
+    jit& operator=(const jit&) = delete;
+    jit(jit&& other) noexcept;
+    jit& operator=(jit&& other) noexcept;
+
+    // forgets every compiled block, their code is overwritten by the next compile
+    void                        reset();
+
+    // compiles the leading supported instructions of code[0, count), compiled is set to
+    // how many. nullptr when there are none or the host cannot run generated code
+    [[nodiscard]] native_block  compile(const instruction* code, uint32_t count, uint32_t pc, uint32_t& compiled);
+    [[nodiscard]] size_t        used() const { return _used; }
+};
+
+#endif //JIT_H
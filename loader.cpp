@@ -0,0 +1,167 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "loader.h"
+#include "decoder.h"
+#include "mapped_file.h"
+
+constexpr size_t   EHDR_SIZE       = 52;
+constexpr size_t   PHDR_SIZE       = 32;
+constexpr size_t   SHDR_SIZE       = 40;
+constexpr size_t   SYM_SIZE        = 16;
+constexpr uint8_t  ELFCLASS32      = 1;
+constexpr uint8_t  ELFDATA2LSB     = 1;
+constexpr uint16_t ET_EXEC         = 2;
+constexpr uint16_t EM_RISCV        = 243;
+constexpr uint32_t PT_LOAD         = 1;
+constexpr uint32_t PF_X            = 1;
+constexpr uint32_t SHT_SYMTAB      = 2;
+constexpr uint8_t  STT_NOTYPE      = 0;
+constexpr uint8_t  STT_FUNC        = 2;
+
+std::vector<uint8_t> loader::read_all(std::istream &in) {
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+uint16_t loader::read_u16(const std::vector<uint8_t> &bytes, const size_t offset) {
+    if (offset + 2 > bytes.size()) throw std::invalid_argument("Truncated image at offset " + std::to_string(offset));
+
+    return static_cast<uint16_t>(bytes[offset] | bytes[offset + 1] << 8);
+}
+uint32_t loader::read_u32(const std::vector<uint8_t> &bytes, const size_t offset) {
+    if (offset + 4 > bytes.size()) throw std::invalid_argument("Truncated image at offset " + std::to_string(offset));
+
+    return static_cast<uint32_t>(bytes[offset]) | static_cast<uint32_t>(bytes[offset + 1]) << 8 |
+           static_cast<uint32_t>(bytes[offset + 2]) << 16 | static_cast<uint32_t>(bytes[offset + 3]) << 24;
+}
+void loader::decode_text(program &prog, const uint32_t address, const std::vector<uint8_t> &bytes) {
+    if (address & 3) throw std::invalid_argument("Text segment is not 4 byte aligned");
+
+    prog.base = address;
+    prog.code.reserve(bytes.size() / 4);
+    for (size_t offset = 0; offset + 4 <= bytes.size(); offset += 4)
+        prog.code.push_back(sink_x0(decoder::decode(read_u32(bytes, offset))));
+}
+void loader::read_symbols(program &prog, const std::vector<uint8_t> &bytes) {
+    const uint32_t shoff = read_u32(bytes, 32);
+    const uint16_t shnum = read_u16(bytes, 48);
+    for (size_t i = 0; i < shnum; ++i) {
+        const size_t sh = shoff + i * SHDR_SIZE;
+        if (read_u32(bytes, sh + 4) != SHT_SYMTAB) continue;
+
+        const uint32_t sym_offset = read_u32(bytes, sh + 16);
+        const uint32_t sym_size = read_u32(bytes, sh + 20);
+        const size_t strtab = shoff + read_u32(bytes, sh + 24) * SHDR_SIZE;
+        const uint32_t str_offset = read_u32(bytes, strtab + 16);
+        const uint32_t str_size = read_u32(bytes, strtab + 20);
+        if (static_cast<uint64_t>(str_offset) + str_size > bytes.size())
+            throw std::invalid_argument("String table outside of file");
+
+        const auto *table = reinterpret_cast<const char *>(bytes.data() + str_offset);
+        for (size_t sym = sym_offset; sym + SYM_SIZE <= sym_offset + sym_size; sym += SYM_SIZE) {
+            const uint32_t name = read_u32(bytes, sym);
+            const uint8_t type = bytes.at(sym + 12) & 0xf;
+            if (name == 0 || read_u16(bytes, sym + 14) == 0) continue;
+
+            if (type != STT_FUNC && type != STT_NOTYPE) continue;
+
+            if (name >= str_size) throw std::invalid_argument("Symbol name outside of string table");
+
+            const char *last = std::find(table + name, table + str_size, '\0');
+            if (last == table + str_size) throw std::invalid_argument("Symbol name is not NUL terminated");
+
+            prog.symbols.emplace(std::string(table + name, last), read_u32(bytes, sym + 4));
+        }
+    }
+}
+
+bool loader::is_elf(std::istream &in) {
+    char magic[4] = {};
+    in.read(magic, 4);
+    const bool elf = in.gcount() == 4 && magic[0] == 0x7f && magic[1] == 'E' && magic[2] == 'L' && magic[3] == 'F';
+    in.clear();
+    in.seekg(0);
+
+    return elf;
+}
+
+program loader::load_elf(std::istream &in) {
+    const std::vector<uint8_t> bytes = read_all(in);
+    if (bytes.size() < EHDR_SIZE || bytes[0] != 0x7f || bytes[1] != 'E' || bytes[2] != 'L' || bytes[3] != 'F')
+        throw std::invalid_argument("Not an ELF file");
+
+    if (bytes[4] != ELFCLASS32 || bytes[5] != ELFDATA2LSB) throw std::invalid_argument("Only little endian ELF32 is supported");
+
+    if (read_u16(bytes, 16) != ET_EXEC) throw std::invalid_argument("ELF is not an executable");
+
+    if (read_u16(bytes, 18) != EM_RISCV) throw std::invalid_argument("ELF is not a RISC-V binary");
+
+    program prog;
+    prog.entry = read_u32(bytes, 24);
+
+    const uint32_t phoff = read_u32(bytes, 28);
+    const uint16_t phnum = read_u16(bytes, 44);
+    bool has_text = false;
+    for (size_t i = 0; i < phnum; ++i) {
+        const size_t ph = phoff + i * PHDR_SIZE;
+        if (read_u32(bytes, ph) != PT_LOAD) continue;
+
+        const uint32_t offset = read_u32(bytes, ph + 4);
+        const uint32_t filesz = read_u32(bytes, ph + 16);
+        if (static_cast<uint64_t>(offset) + filesz > bytes.size()) throw std::invalid_argument("Segment outside of file");
+
+        segment seg{read_u32(bytes, ph + 8), read_u32(bytes, ph + 20), {bytes.begin() + offset, bytes.begin() + offset + filesz}};
+        if (seg.size < filesz) throw std::invalid_argument("Segment memory size smaller than file size");
+
+        if (read_u32(bytes, ph + 24) & PF_X) {
+            if (has_text) throw std::invalid_argument("Only one executable segment is supported");
+
+            decode_text(prog, seg.address, seg.bytes);
+            has_text = true;
+        }
+
+        prog.segments.push_back(std::move(seg));
+    }
+
+    if (!has_text) throw std::invalid_argument("ELF has no executable segment");
+
+    read_symbols(prog, bytes);
+
+    return prog;
+}
+
+program loader::load_flat(std::istream &in, const uint32_t base) {
+    program prog;
+    std::vector<uint8_t> bytes = read_all(in);
+    decode_text(prog, base, bytes);
+    prog.entry = base;
+
+    const auto size = static_cast<uint32_t>(bytes.size());
+    prog.segments.push_back({base, size, std::move(bytes)});
+
+    return prog;
+}
+program loader::load(std::istream &in, const std::string &path, assembler &as) {
+    if (is_elf(in)) return load_elf(in);
+
+    const std::string flat = ".bin";
+    if (path.size() >= flat.size() && path.compare(path.size() - flat.size(), flat.size(), flat) == 0)
+        return load_flat(in);
+
+    return as.assemble(in);
+}
+program loader::load(const std::string &path, assembler &as, const program_cache *cache) {
+    const mapped_file file(path);
+    const std::string_view text = file.text();
+    if (!text.starts_with("\x7f" "ELF") && !path.ends_with(".bin")) return cache ? cache->assemble(text, as) : as.assemble(text);
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::invalid_argument("Cannot open " + path);
+    return load(in, path, as);
+}
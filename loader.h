@@ -0,0 +1,36 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef LOADER_H
+#define LOADER_H
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "instruction.h"
+#include "program_cache.h"
+
+// binary images -> program, the segments still have to be copied into guest memory
+class loader {
+    [[nodiscard]] static std::vector<uint8_t> read_all(std::istream& in);
+    [[nodiscard]] static uint16_t   read_u16(const std::vector<uint8_t>& bytes, size_t offset);
+    [[nodiscard]] static uint32_t   read_u32(const std::vector<uint8_t>& bytes, size_t offset);
+    static void                     decode_text(program& prog, uint32_t address, const std::vector<uint8_t>& bytes);
+    static void                     read_symbols(program& prog, const std::vector<uint8_t>& bytes);
+public:
+    [[nodiscard]] static bool       is_elf(std::istream& in);
+    [[nodiscard]] static program    load_elf(std::istream& in);
+    [[nodiscard]] static program    load_flat(std::istream& in, uint32_t base = 0);
+    // ELF by content, a flat image by the .bin extension, anything else is assembled
+    // with as, whose errors() the caller checks. binaries throw std::invalid_argument
+    [[nodiscard]] static program    load(std::istream& in, const std::string& path, assembler& as);
+    // the same by path, assembly source is mapped and tokenized in place, or taken
+    // from cache when one is given and already holds it
+    [[nodiscard]] static program    load(const std::string& path, assembler& as, const program_cache* cache = nullptr);
+};
+
+#endif //LOADER_H
@@ -1,36 +1,259 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <optional>
+#include <string>
+#include "assembler.h"
+#include "batch.h"
 #include "cpu.h"
+#include "disassembler.h"
+#include "fusion.h"
+#include "loader.h"
+#include "profiler.h"
+#include "program_cache.h"
+#include "replayer.h"
+#include "smp.h"
+#include "snapshot.h"
+#include "trace.h"
 
-int main() {
-    std::ifstream fin("risc-v.asm");
-    cpu cpu;
-
-    std::string line;
-    // fetch
-    // while (true) {
-    //     if (getchar() && std::getline(fin, line)) {
-    //         // decode
-    //         try {
-    //             auto copy_line = line;
-    //             cpu.execute_instruction(line);
-    //             cpu.print_registers(false);
-    //             std::cout << "ran> " << copy_line << std::endl;
-    //         } catch (const std::invalid_argument &e) {
-    //             std::cout << e.what() << std::endl;
-    //         }
-    //     }
-    // }
-    uint64_t line_number = 0;
-    while (std::getline(fin, line)) {
+// the whole value has to be a non-negative number, stoull would take "-1" or "12abc"
+static uint64_t parse_count(const std::string &option, const std::string_view value) {
+    uint64_t count = 0;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (ec != std::errc() || end != value.data() + value.size())
+        throw std::invalid_argument("Invalid value for " + option + ": " + std::string(value));
+
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    std::string path = "risc-v.asm";
+    memory_model model = memory_model::FLAT;
+    engine mode = DEFAULT_ENGINE;
+    bool fuse = false;
+    bool disassemble = false;
+    std::string profile_path;
+    uint64_t profile_interval = DEFAULT_PROFILE_INTERVAL;
+    std::string trace_path;
+    std::string replay_path;
+    uint64_t replay_at = UINT64_MAX;
+    std::string snapshot_path;
+    std::string restore_path;
+    std::string batch_path;
+    std::string output_path;
+    std::string cache_path;
+    size_t threads = 0;
+    size_t harts = 0;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--paged")
+                model = memory_model::PAGED;
+            else if (arg == "--switch")
+                mode = engine::SWITCH;
+            else if (arg == "--blocks")
+                mode = engine::BLOCK;
+            else if (arg == "--jit")
+                mode = engine::JIT;
+            else if (arg == "--fuse")
+                fuse = true;
+            else if (arg == "--disassemble")
+                disassemble = true;
+            else if (arg == "--profile" && i + 1 < argc)
+                profile_path = argv[++i];
+            else if (arg == "--profile-interval" && i + 1 < argc)
+                profile_interval = std::max<uint64_t>(parse_count(arg, argv[++i]), 1);
+            else if (arg == "--trace" && i + 1 < argc)
+                trace_path = argv[++i];
+            else if (arg == "--replay" && i + 1 < argc)
+                replay_path = argv[++i];
+            else if (arg == "--at" && i + 1 < argc)
+                replay_at = parse_count(arg, argv[++i]);
+            else if (arg == "--snapshot" && i + 1 < argc)
+                snapshot_path = argv[++i];
+            else if (arg == "--restore" && i + 1 < argc)
+                restore_path = argv[++i];
+            else if (arg == "--batch" && i + 1 < argc)
+                batch_path = argv[++i];
+            else if (arg == "--output" && i + 1 < argc)
+                output_path = argv[++i];
+            else if (arg == "--cache" && i + 1 < argc)
+                cache_path = argv[++i];
+            else if (arg == "--threads" && i + 1 < argc)
+                threads = parse_count(arg, argv[++i]);
+            else if (arg == "--harts" && i + 1 < argc)
+                harts = parse_count(arg, argv[++i]);
+            else
+                path = arg;
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    // decoded assembly is kept between runs when asked for
+    std::optional<program_cache> cache;
+    if (!cache_path.empty()) {
         try {
-            ++line_number;
-            cpu.execute_instruction(line, line_number);
+            cache.emplace(cache_path);
         } catch (const std::invalid_argument &e) {
             std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // every manifest line runs on its own cpu, the results go to --output or stdout
+    if (!batch_path.empty()) {
+        std::ifstream manifest(batch_path);
+        if (!manifest) {
+            std::cout << "Cannot open " << batch_path << std::endl;
+            return 1;
+        }
+
+        std::vector<std::string> errors;
+        const auto jobs = batch::parse_manifest(manifest, errors);
+        for (const auto &e : errors)
+            std::cerr << batch_path << ": " << e << std::endl;
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = batch::run(jobs, mode, model, threads, cache ? &*cache : nullptr);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (output_path.empty())
+            batch::write_json(std::cout, jobs, results);
+        else {
+            std::ofstream out(output_path);
+            batch::write_json(out, jobs, results);
+        }
+        std::cerr << "Batch: " << jobs.size() << " jobs in " << seconds << " s" << std::endl;
+        return 0;
+    }
+
+    assembler as;
+    as.set_threads(threads);
+    cpu cpu(DEFAULT_MEMORY_SIZE, model);
+    program prog;
+
+    // decode the whole file once, the executor never sees the source text
+    try {
+        prog = loader::load(path, as, cache ? &*cache : nullptr);
+    } catch (const std::invalid_argument &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    // the placeholders for the bad lines would trap, there is no point in running
+    for (const auto &e : as.errors())
+        std::cout << e << std::endl;
+    if (!as.errors().empty()) return 1;
+
+    std::array<uint64_t, FUSED_COUNT> sites = {};
+    if (fuse) sites = fusion::run(prog);
+
+    // the listing of what would run, nothing is executed
+    if (disassemble) {
+        disassembler(prog).print(std::cout);
+        return 0;
+    }
+
+    // the state after --at instructions comes from the trace, nothing is executed
+    if (!replay_path.empty()) {
+        std::ifstream tin(replay_path, std::ios::binary);
+        if (!tin) {
+            std::cout << "Cannot open " << replay_path << std::endl;
+            return 1;
+        }
+        try {
+            replayer rep(tin, prog);
+            rep.seek(replay_at);
+            std::cout << "Replayed " << rep.index() << " of " << rep.records() << " instructions, pc = 0x"
+                      << std::hex << rep.state().pc << std::dec << std::endl;
+            rep.state().print_registers(false);
+        } catch (const std::invalid_argument &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // harts share flat memory, each reports on its own
+    if (harts > 0) {
+        if (model == memory_model::PAGED) {
+            std::cout << "--paged cannot be used with --harts, harts only share flat memory" << std::endl;
+            return 1;
+        }
+        try {
+            smp machine(harts);
+            machine.map_segments(prog);
+            const auto results = machine.execute(prog, mode);
+            for (size_t i = 0; i < machine.size(); ++i) {
+                std::cout << "Hart " << i << ":" << std::endl;
+                if (results[i] != status::HALTED)
+                    std::cout << machine.hart(i).describe_trap(prog) << std::endl;
+                machine.hart(i).print_registers(false);
+            }
+        } catch (const std::invalid_argument &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    try {
+        // a restored machine already holds the program's memory and carries on from its pc
+        const bool restored = !restore_path.empty();
+        if (restored) {
+            cpu = snapshot::load(restore_path).fork();
+            model = cpu.model();
+        } else
+            cpu.map_segments(prog);
+
+        status result;
+        if (restored)
+            result = cpu.resume(prog, mode);
+        else if (!trace_path.empty()) {
+            // tracing needs every step, so it always runs on the switch engine
+            trace_writer trace(trace_path, model, cpu.memory.size(), prog.entry, cpu.registers.data());
+            result = cpu.execute_traced(prog, trace);
+
+            if (trace.finish(cpu.pc))
+                std::cout << "Trace: " << trace.records() << " instructions written to " << trace_path << std::endl;
+            else
+                std::cout << "Cannot write " << trace_path << std::endl;
+        } else if (profile_path.empty())
+            result = cpu.execute(prog, mode);
+        else {
+            // profiling needs every step, so it always runs on the switch engine
+            profiler prof(prog, profile_interval);
+            result = cpu.execute_profiled(prog, prof);
+
+            std::ofstream fout(profile_path);
+            prof.write(fout);
+            std::cout << "Profile: " << prof.samples() << " samples written to " << profile_path << std::endl;
+        }
+        if (result != status::HALTED)
+            std::cout << cpu.describe_trap(prog) << std::endl;
+
+        if (!snapshot_path.empty()) {
+            const snapshot snap(cpu);
+            snap.save(snapshot_path);
+            std::cout << "Snapshot: pc = 0x" << std::hex << snap.pc() << std::dec << " saved to " << snapshot_path << std::endl;
         }
+    } catch (const std::invalid_argument &e) {
+        std::cout << e.what() << std::endl;
     }
     cpu.print_registers(false);
+#ifdef RISCV_COUNTERS
+    cpu.mix().print();
+#endif
+    if (model == memory_model::PAGED)
+        std::cout << "TLB: " << cpu.paged.tlb_hits() << " hits, " << cpu.paged.tlb_misses() << " misses, "
+                  << cpu.paged.resident_pages() << " resident pages" << std::endl;
+    if (fuse)
+        for (size_t i = 0; i < FUSED_COUNT; ++i)
+            std::cout << "Fused " << fusion::name(i) << ": " << sites[i] << " sites, " << cpu.fused[i] << " executed" << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
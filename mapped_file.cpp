@@ -0,0 +1,39 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+mapped_file::mapped_file(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::invalid_argument("Cannot open " + path);
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        throw std::invalid_argument("Cannot open " + path);
+    }
+
+    // an empty file has nothing to map, the mapping outlives the fd
+    _size = static_cast<size_t>(st.st_size);
+    if (_size > 0) {
+        void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::invalid_argument("Cannot map " + path);
+        }
+        madvise(data, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(data);
+    }
+    close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (_data) munmap(const_cast<char *>(_data), _size);
+}
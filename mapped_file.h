@@ -0,0 +1,26 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// a whole file mapped read only, the pages are read in by the host as they are touched
+class mapped_file {
+    const char* _data = nullptr;
+    size_t      _size = 0;
+public:
+    // throws std::invalid_argument when the file cannot be opened or mapped
+    explicit mapped_file(const std::string& path);
+    ~mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    [[nodiscard]] std::string_view  text() const { return {_data, _size}; }
+    [[nodiscard]] size_t            size() const { return _size; }
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,209 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory.h"
+
+flat_memory::flat_memory(const uint64_t size) {
+    if (size > (1ULL << 32)) throw std::invalid_argument("Invalid memory size: " + std::to_string(size));
+
+    if (size == 0) return;
+
+    // anonymous mappings are page aligned and zero filled lazily by the host
+    _size = (size + PAGE_SIZE - 1) & ~static_cast<uint64_t>(PAGE_SIZE - 1);
+    void *data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::invalid_argument("Cannot allocate guest memory: " + std::to_string(_size));
+
+    _data = static_cast<uint8_t *>(data);
+}
+flat_memory::flat_memory(const int fd, const uint64_t offset, const uint64_t size) {
+    if (size > (1ULL << 32)) throw std::invalid_argument("Invalid memory size: " + std::to_string(size));
+
+    if (size == 0) return;
+
+    // writes land in private copies of the touched pages, the rest stays shared with the file
+    _size = (size + PAGE_SIZE - 1) & ~static_cast<uint64_t>(PAGE_SIZE - 1);
+    void *data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+    if (data == MAP_FAILED) throw std::invalid_argument("Cannot map guest memory: " + std::to_string(_size));
+
+    _data = static_cast<uint8_t *>(data);
+}
+flat_memory::~flat_memory() {
+    if (_data && _owner) munmap(_data, _size);
+}
+flat_memory::flat_memory(flat_memory &&other) noexcept :
+    _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)),
+    _owner(std::exchange(other._owner, true)) {
+}
+flat_memory &flat_memory::operator=(flat_memory &&other) noexcept {
+    if (this != &other) {
+        if (_data && _owner) munmap(_data, _size);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+        _owner = std::exchange(other._owner, true);
+    }
+    return *this;
+}
+flat_memory flat_memory::share() const {
+    flat_memory view(0);
+    view._data = _data;
+    view._size = _size;
+    view._owner = false;
+    return view;
+}
+uint8_t *flat_memory::host(const uint32_t addr, const uint64_t count) const {
+    if (static_cast<uint64_t>(addr) + count > _size) return nullptr;
+
+    return _data + addr;
+}
+void flat_memory::fault(const uint32_t addr, const size_t width, const bool write) {
+    std::ostringstream oss;
+    oss << (write ? "Store" : "Load") << " access fault: " << width << " bytes at 0x" << std::hex << addr;
+    throw std::invalid_argument(oss.str());
+}
+void flat_memory::write(const uint32_t addr, const uint8_t *bytes, const size_t count) {
+    if (static_cast<uint64_t>(addr) + count > _size) fault(addr, count, true);
+
+    std::memcpy(_data + addr, bytes, count);
+}
+void flat_memory::clear(const uint32_t addr, const size_t count) {
+    if (static_cast<uint64_t>(addr) + count > _size) fault(addr, count, true);
+
+    std::memset(_data + addr, 0, count);
+}
+bool flat_memory::dump(const int fd, const uint64_t offset) const {
+    // every page is looked at, residency says nothing about whether a page was written: one
+    // the host swapped out still holds data. a page the guest never touched reads as zero
+    static const uint8_t zero[PAGE_SIZE] = {};
+    for (uint64_t i = 0; i < _size / PAGE_SIZE; ++i) {
+        const uint8_t *page = _data + i * PAGE_SIZE;
+        if (std::memcmp(page, zero, PAGE_SIZE) == 0) continue;
+
+        if (pwrite(fd, page, PAGE_SIZE, static_cast<off_t>(offset + i * PAGE_SIZE)) != PAGE_SIZE) return false;
+    }
+    return true;
+}
+
+paged_memory::paged_memory(paged_memory &&other) noexcept :
+    _directory(std::move(other._directory)), _pages(std::exchange(other._pages, 0)),
+    _tlb_hits(other._tlb_hits), _tlb_misses(other._tlb_misses) {
+    // the entries still point at pages that now belong to this
+    _tlb = other._tlb;
+    other.flush_tlb();
+}
+paged_memory &paged_memory::operator=(paged_memory &&other) noexcept {
+    if (this != &other) {
+        _directory = std::move(other._directory);
+        _pages = std::exchange(other._pages, 0);
+        _tlb = other._tlb;
+        _tlb_hits = other._tlb_hits;
+        _tlb_misses = other._tlb_misses;
+        other.flush_tlb();
+    }
+    return *this;
+}
+const uint8_t *paged_memory::zero_page() {
+    static const page zero{};
+    return zero.data();
+}
+void paged_memory::flush_tlb() const {
+    _tlb.fill({});
+}
+paged_memory paged_memory::fork() const {
+    paged_memory copy;
+    for (size_t i = 0; i < _directory.size(); ++i)
+        if (_directory[i]) copy._directory[i] = std::make_unique<table>(*_directory[i]);
+    copy._pages = _pages;
+
+    // the pages this instance could write are shared now
+    flush_tlb();
+    return copy;
+}
+void paged_memory::for_each_page(const std::function<void(uint32_t vpn, const uint8_t *bytes)> &visit) const {
+    for (uint32_t i = 0; i < _directory.size(); ++i) {
+        if (!_directory[i]) continue;
+
+        for (uint32_t j = 0; j < 1024; ++j)
+            if (const auto &page = (*_directory[i])[j]) visit(i << 10 | j, page->data());
+    }
+}
+const std::shared_ptr<paged_memory::page> *paged_memory::slot(const uint32_t vpn) const {
+    const auto &table = _directory[vpn >> 10];
+    if (!table) return nullptr;
+
+    const auto &page = (*table)[vpn & 1023];
+    return page ? &page : nullptr;
+}
+uint8_t *paged_memory::find_page(const uint32_t vpn) const {
+    const std::shared_ptr<page> *p = slot(vpn);
+    return p ? (*p)->data() : nullptr;
+}
+uint8_t *paged_memory::touch_page(const uint32_t vpn) {
+    auto &table = _directory[vpn >> 10];
+    if (!table) table = std::make_unique<paged_memory::table>();
+
+    auto &page = (*table)[vpn & 1023];
+    if (!page) {
+        page = std::make_shared<paged_memory::page>();
+        ++_pages;
+    } else if (page.use_count() > 1) {
+        // copy on write, a read entry may still point at the shared page
+        page = std::make_shared<paged_memory::page>(*page);
+        _tlb[vpn & (TLB_SIZE - 1)] = {};
+    }
+
+    return page->data();
+}
+void paged_memory::write(uint32_t addr, const uint8_t *bytes, size_t count) {
+    while (count > 0) {
+        const size_t offset = addr & (PAGE_SIZE - 1);
+        const size_t chunk = std::min(count, PAGE_SIZE - offset);
+        std::memcpy(touch_page(addr >> PAGE_SHIFT) + offset, bytes, chunk);
+        addr += chunk;
+        bytes += chunk;
+        count -= chunk;
+    }
+}
+void paged_memory::clear(uint32_t addr, size_t count) {
+    // pages that were never written already read as zero
+    while (count > 0) {
+        const size_t offset = addr & (PAGE_SIZE - 1);
+        const size_t chunk = std::min(count, PAGE_SIZE - offset);
+        if (find_page(addr >> PAGE_SHIFT)) std::memset(touch_page(addr >> PAGE_SHIFT) + offset, 0, chunk);
+        addr += chunk;
+        count -= chunk;
+    }
+}
+const uint8_t *paged_memory::readable(const uint32_t addr) const {
+    const uint8_t *page = find_page(addr >> PAGE_SHIFT);
+    return (page ? page : zero_page()) + (addr & (PAGE_SIZE - 1));
+}
+uint8_t *paged_memory::writable(const uint32_t addr) {
+    // a read entry may still map the zero page or the shared copy
+    uint8_t *page = touch_page(addr >> PAGE_SHIFT);
+    _tlb[(addr >> PAGE_SHIFT) & (TLB_SIZE - 1)] = {};
+    return page + (addr & (PAGE_SIZE - 1));
+}
+void paged_memory::release(uint32_t addr, size_t count) {
+    // only whole pages can be given back
+    const uint64_t first = (static_cast<uint64_t>(addr) + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    const uint64_t last = (static_cast<uint64_t>(addr) + count) >> PAGE_SHIFT;
+    for (uint64_t vpn = first; vpn < last; ++vpn) {
+        auto &table = _directory[vpn >> 10];
+        if (!table || !(*table)[vpn & 1023]) continue;
+
+        (*table)[vpn & 1023].reset();
+        --_pages;
+    }
+
+    flush_tlb();
+}
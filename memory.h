@@ -0,0 +1,224 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef MEMORY_H
+#define MEMORY_H
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+constexpr size_t PAGE_SIZE = 4096;
+constexpr size_t PAGE_SHIFT = 12;
+constexpr size_t DEFAULT_MEMORY_SIZE = 64 * 1024 * 1024;
+constexpr uint32_t PAGED_STACK_TOP = 0x80000000;
+
+enum class memory_model : uint8_t {
+    FLAT,
+    PAGED
+};
+
+template <typename T>
+[[nodiscard]] T to_little_endian(T value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        T swapped = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            swapped = static_cast<T>(swapped << 8 | (value >> (i * 8) & 0xff));
+        return swapped;
+    }
+
+    return value;
+}
+
+// one contiguous, page aligned, zero filled guest address space starting at 0
+class flat_memory {
+    uint8_t*    _data = nullptr;
+    uint64_t    _size = 0;
+    bool        _owner = true;   // views from share() never unmap
+
+    [[noreturn]] static void fault(uint32_t addr, size_t width, bool write);
+public:
+    // a size of 0 maps nothing and faults on every access
+    explicit flat_memory(uint64_t size = DEFAULT_MEMORY_SIZE);
+    // a private copy on write mapping of size bytes of fd at offset, the file is never written.
+    // throws std::invalid_argument when it cannot be mapped
+    flat_memory(int fd, uint64_t offset, uint64_t size);
+    ~flat_memory();
+    flat_memory(const flat_memory&) = delete;
+    flat_memory& operator=(const flat_memory&) = delete;
+    flat_memory(flat_memory&& other) noexcept;
+    flat_memory& operator=(flat_memory&& other) noexcept;
+
+    [[nodiscard]] uint64_t  size() const { return _size; }
+    // a view of the same bytes for another hart, it must not outlive this instance
+    [[nodiscard]] flat_memory share() const;
+    // the host bytes behind [addr, addr + count) for handing to host calls, nullptr when out of range
+    [[nodiscard]] uint8_t*  host(uint32_t addr, uint64_t count) const;
+    void                    write(uint32_t addr, const uint8_t* bytes, size_t count);
+    void                    clear(uint32_t addr, size_t count);
+    // writes every page that is not all zero to fd at offset + its address, false on a write error
+    [[nodiscard]] bool      dump(int fd, uint64_t offset) const;
+
+    // the bounds check is a single compare, false when the access faults. the
+    // caller decides how to report it, nothing is thrown on the execution path
+    template <typename T>
+    [[nodiscard]] bool load(const uint32_t addr, T& value) const {
+        static_assert(std::is_unsigned_v<T>);
+        if (static_cast<uint64_t>(addr) + sizeof(T) > _size) return false;
+
+        std::memcpy(&value, _data + addr, sizeof(T));
+        value = to_little_endian(value);
+        return true;
+    }
+
+    template <typename T>
+    [[nodiscard]] bool store(const uint32_t addr, const T value) {
+        static_assert(std::is_unsigned_v<T>);
+        if (static_cast<uint64_t>(addr) + sizeof(T) > _size) return false;
+
+        const T le = to_little_endian(value);
+        std::memcpy(_data + addr, &le, sizeof(T));
+        return true;
+    }
+
+    // the host word behind an aligned guest word for the atomics, nullptr when the access faults
+    [[nodiscard]] uint32_t* word(const uint32_t addr) const {
+        if ((addr & 3) != 0 || static_cast<uint64_t>(addr) + 4 > _size) return nullptr;
+
+        return reinterpret_cast<uint32_t *>(_data + addr);
+    }
+};
+
+// the whole 32 bit address space, 4 KiB pages are allocated on first write,
+// reads of pages that were never written return zeros. pages are shared copy on
+// write between an instance and its forks, only pages nobody else holds are written
+class paged_memory {
+    using page = std::array<uint8_t, PAGE_SIZE>;
+    using table = std::array<std::shared_ptr<page>, 1024>;
+
+    static constexpr size_t   TLB_SIZE = 256;
+    static constexpr uint32_t PAGE_MASK = ~static_cast<uint32_t>(PAGE_SIZE - 1);
+    // low bits that no masked address can have
+    static constexpr uint32_t INVALID_TAG = PAGE_SIZE - 1;
+
+    // direct mapped by vpn, host is the host address of the page minus its guest address.
+    // pages that were never written or are shared are mapped read only
+    struct tlb_entry {
+        uint32_t    read_tag = INVALID_TAG;
+        uint32_t    write_tag = INVALID_TAG;
+        uintptr_t   host = 0;
+    };
+
+    std::array<std::unique_ptr<table>, 1024> _directory;
+    size_t              _pages = 0;
+
+    mutable std::array<tlb_entry, TLB_SIZE> _tlb;
+    mutable uint64_t    _tlb_hits = 0;
+    mutable uint64_t    _tlb_misses = 0;
+
+    [[nodiscard]] const std::shared_ptr<page>* slot(uint32_t vpn) const;
+    [[nodiscard]] uint8_t*  find_page(uint32_t vpn) const;
+    [[nodiscard]] uint8_t*  touch_page(uint32_t vpn);
+    [[nodiscard]] static const uint8_t* zero_page();
+
+    // misaligned accesses never match a tag and end up here as well
+    template <typename T>
+    [[nodiscard]] T load_slow(const uint32_t addr) const {
+        ++_tlb_misses;
+        if (const uint32_t offset = addr & (PAGE_SIZE - 1); offset <= PAGE_SIZE - sizeof(T)) {
+            const uint32_t vpn = addr >> PAGE_SHIFT;
+            const std::shared_ptr<page> *p = slot(vpn);
+            tlb_entry &entry = _tlb[vpn & (TLB_SIZE - 1)];
+            entry.read_tag = addr & PAGE_MASK;
+            entry.write_tag = p && p->use_count() == 1 ? addr & PAGE_MASK : INVALID_TAG;
+            entry.host = reinterpret_cast<uintptr_t>(p ? (*p)->data() : zero_page()) - (addr & PAGE_MASK);
+
+            T value;
+            std::memcpy(&value, reinterpret_cast<const uint8_t *>(entry.host + addr), sizeof(T));
+            return to_little_endian(value);
+        }
+
+        // the access straddles two pages
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value = static_cast<T>(value | static_cast<T>(load<uint8_t>(addr + i)) << (i * 8));
+        return value;
+    }
+
+    template <typename T>
+    void store_slow(const uint32_t addr, const T value) {
+        ++_tlb_misses;
+        if (const uint32_t offset = addr & (PAGE_SIZE - 1); offset <= PAGE_SIZE - sizeof(T)) {
+            const uint32_t vpn = addr >> PAGE_SHIFT;
+            tlb_entry &entry = _tlb[vpn & (TLB_SIZE - 1)];
+            entry.read_tag = addr & PAGE_MASK;
+            entry.write_tag = addr & PAGE_MASK;
+            entry.host = reinterpret_cast<uintptr_t>(touch_page(vpn)) - (addr & PAGE_MASK);
+
+            const T le = to_little_endian(value);
+            std::memcpy(reinterpret_cast<uint8_t *>(entry.host + addr), &le, sizeof(T));
+            return;
+        }
+
+        for (size_t i = 0; i < sizeof(T); ++i)
+            store<uint8_t>(addr + i, static_cast<uint8_t>(value >> (i * 8)));
+    }
+public:
+    paged_memory() = default;
+    paged_memory(const paged_memory&) = delete;
+    paged_memory& operator=(const paged_memory&) = delete;
+    paged_memory(paged_memory&& other) noexcept;
+    paged_memory& operator=(paged_memory&& other) noexcept;
+
+    // a new instance sharing every page with this one, neither sees the other's writes
+    [[nodiscard]] paged_memory fork() const;
+    void                    for_each_page(const std::function<void(uint32_t vpn, const uint8_t* bytes)>& visit) const;
+
+    [[nodiscard]] size_t    resident_pages() const { return _pages; }
+    [[nodiscard]] uint64_t  tlb_hits() const { return _tlb_hits; }
+    [[nodiscard]] uint64_t  tlb_misses() const { return _tlb_misses; }
+    void                    write(uint32_t addr, const uint8_t* bytes, size_t count);
+    void                    clear(uint32_t addr, size_t count);
+    // frees every page fully inside the range, they read as zero again
+    void                    release(uint32_t addr, size_t count);
+    // must be called whenever a page is freed or replaced
+    void                    flush_tlb() const;
+    // the host bytes from addr to the end of its page for handing to host calls,
+    // writable() gives the page its own copy first
+    [[nodiscard]] const uint8_t*    readable(uint32_t addr) const;
+    [[nodiscard]] uint8_t*          writable(uint32_t addr);
+
+    // a hit is one compare and one add, the mask also sends misaligned accesses to the slow path
+    template <typename T>
+    [[nodiscard]] T load(const uint32_t addr) const {
+        static_assert(std::is_unsigned_v<T>);
+        const tlb_entry &entry = _tlb[(addr >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+        if ((addr & (PAGE_MASK | (sizeof(T) - 1))) != entry.read_tag) return load_slow<T>(addr);
+
+        ++_tlb_hits;
+        T value;
+        std::memcpy(&value, reinterpret_cast<const uint8_t *>(entry.host + addr), sizeof(T));
+        return to_little_endian(value);
+    }
+
+    template <typename T>
+    void store(const uint32_t addr, const T value) {
+        static_assert(std::is_unsigned_v<T>);
+        const tlb_entry &entry = _tlb[(addr >> PAGE_SHIFT) & (TLB_SIZE - 1)];
+        if ((addr & (PAGE_MASK | (sizeof(T) - 1))) != entry.write_tag) {
+            store_slow<T>(addr, value);
+            return;
+        }
+
+        ++_tlb_hits;
+        const T le = to_little_endian(value);
+        std::memcpy(reinterpret_cast<uint8_t *>(entry.host + addr), &le, sizeof(T));
+    }
+};
+
+#endif //MEMORY_H
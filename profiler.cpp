@@ -0,0 +1,68 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <sstream>
+
+#include "profiler.h"
+
+profiler::profiler(const program &prog, const uint64_t interval) :
+    _interval(interval ? interval : 1), _countdown(_interval) {
+    _symbols.reserve(prog.symbols.size());
+    for (const auto &[name, addr] : prog.symbols)
+        _symbols.emplace_back(addr, name);
+    std::sort(_symbols.begin(), _symbols.end());
+
+    // the entry is the root of every stack
+    _stack.push_back({prog.entry, 0});
+}
+
+std::string profiler::symbolize(const uint32_t addr) const {
+    const auto it = std::upper_bound(_symbols.begin(), _symbols.end(), addr,
+                                     [](const uint32_t a, const auto &sym) { return a < sym.first; });
+    if (it != _symbols.begin()) return std::prev(it)->second;
+
+    std::ostringstream oss;
+    oss << "0x" << std::hex << addr;
+    return oss.str();
+}
+
+void profiler::call(const uint32_t target, const uint32_t return_pc) {
+    // runaway recursion keeps the deepest frames out, their returns then match nothing
+    if (_stack.size() < MAX_PROFILE_DEPTH) _stack.push_back({target, return_pc});
+}
+
+void profiler::ret(const uint32_t target) {
+    for (size_t i = _stack.size(); i-- > 1;) {
+        if (_stack[i].return_pc != target) continue;
+
+        _stack.resize(i);
+        return;
+    }
+}
+
+void profiler::tail(const uint32_t target) {
+    _stack.back().function = target;
+}
+
+void profiler::sample(const uint32_t pc) {
+    ++_samples;
+
+    std::string folded;
+    for (const auto &f : _stack) {
+        if (!folded.empty()) folded += ';';
+        folded += symbolize(f.function);
+    }
+
+    // labels inside a function, loops usually, show up as one more frame
+    const std::string leaf = symbolize(pc);
+    if (leaf != symbolize(_stack.back().function)) folded += ';' + leaf;
+
+    ++_folded[folded];
+}
+
+void profiler::write(std::ostream &out) const {
+    for (const auto &[stack, count] : _folded)
+        out << stack << ' ' << count << '\n';
+}
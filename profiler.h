@@ -0,0 +1,59 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "instruction.h"
+
+constexpr uint64_t DEFAULT_PROFILE_INTERVAL = 1000;
+constexpr size_t   MAX_PROFILE_DEPTH = 1024;
+
+// samples the guest pc every interval retired instructions under a shadow call
+// stack kept from call/ret, output is the folded format flamegraph tools read
+class profiler {
+    struct frame {
+        uint32_t    function;
+        uint32_t    return_pc;
+    };
+
+    std::vector<std::pair<uint32_t, std::string>> _symbols; // sorted by address
+    std::vector<frame>                  _stack;
+    std::map<std::string, uint64_t>     _folded;
+    uint64_t                            _interval;
+    uint64_t                            _countdown;
+    uint64_t                            _samples = 0;
+
+    [[nodiscard]] std::string symbolize(uint32_t addr) const;
+    void                      sample(uint32_t pc);
+public:
+    // frames are named after the closest label or ELF symbol at or below their address
+    explicit profiler(const program& prog, uint64_t interval = DEFAULT_PROFILE_INTERVAL);
+
+    void call(uint32_t target, uint32_t return_pc);
+    // unwinds to the frame that returns to target, returns that match no frame are ignored
+    void ret(uint32_t target);
+    void tail(uint32_t target);
+
+    // once per retired instruction
+    void tick(const uint32_t pc) {
+        if (--_countdown) return;
+
+        _countdown = _interval;
+        sample(pc);
+    }
+
+    [[nodiscard]] uint64_t samples() const { return _samples; }
+    // one "root;caller;callee count" line per distinct stack
+    void                   write(std::ostream& out) const;
+};
+
+#endif //PROFILER_H
@@ -0,0 +1,264 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "isa.h"
+#include "mapped_file.h"
+#include "program_cache.h"
+
+static void put_u32(std::vector<uint8_t> &out, const uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void put_u64(std::vector<uint8_t> &out, const uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value));
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+static uint64_t get_u64(const uint8_t *in) {
+    return get_u32(in) | static_cast<uint64_t>(get_u32(in + 4)) << 32;
+}
+
+// the payload hash only catches damage, an image that hashes fine can still come from a
+// broken writer. the engines index registers and code with these fields unchecked
+static bool valid_code(const program &prog) {
+    const auto size = static_cast<int64_t>(prog.code.size());
+    for (int64_t i = 0; i < size; ++i) {
+        const instruction &in = prog.code[i];
+        // only assembler output is cached, superinstructions are made after loading
+        if (static_cast<size_t>(in.op) >= INSTRUCTIONS_COUNT) return false;
+        if (in.rd > SINK || in.rs1 > SINK || in.rs2 > SINK) return false;
+
+        switch (format_of(in.op)) {
+            // targets are labels, a label may sit just past the last instruction
+            case operands::TARGET:
+            case operands::RS1_TARGET:
+            case operands::RS1_TARGET_SWAPPED:
+            case operands::RS1_RS2_TARGET:
+            case operands::JAL: {
+                const int64_t target = i + in.imm / 4;
+                if (in.imm % 4 != 0 || target < 0 || target > size) return false;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    const uint64_t entry = static_cast<uint64_t>(prog.entry) - prog.base;
+    return prog.entry >= prog.base && entry % 4 == 0 && entry / 4 <= prog.code.size();
+}
+
+// everything past the header checked against the header, false on the first thing that does not add up
+static bool decode_image(const std::string_view image, const uint64_t key, const size_t source_size, program &prog) {
+    const auto *header = reinterpret_cast<const uint8_t *>(image.data());
+    if (image.size() < PROGRAM_CACHE_HEADER_SIZE || get_u32(header) != PROGRAM_CACHE_MAGIC ||
+        header[4] != PROGRAM_CACHE_VERSION || header[5] != INSTRUCTIONS_COUNT)
+        return false;
+    if (get_u64(header + 8) != key || get_u64(header + 16) != source_size) return false;
+
+    // a torn or corrupted write fails here before anything is decoded
+    const std::string_view payload = image.substr(PROGRAM_CACHE_HEADER_SIZE);
+    if (get_u64(header + 48) != payload.size() || program_cache::hash(payload) != get_u64(header + 56)) return false;
+
+    const auto *p = reinterpret_cast<const uint8_t *>(payload.data());
+    const uint8_t *end = p + payload.size();
+    const auto fits = [&](const uint64_t count) { return static_cast<uint64_t>(end - p) >= count; };
+
+    program out;
+    out.base = get_u32(header + 24);
+    out.entry = get_u32(header + 28);
+    const uint32_t code_count = get_u32(header + 32);
+    const uint32_t symbol_count = get_u32(header + 36);
+    const uint32_t segment_count = get_u32(header + 40);
+
+    if (!fits(static_cast<uint64_t>(code_count) * (sizeof(instruction) + sizeof(uint64_t)))) return false;
+    out.code.resize(code_count);
+    out.lines.resize(code_count);
+    if constexpr (std::endian::native == std::endian::little) {
+        // the file layout is the in memory one, both arrays are a single copy
+        std::memcpy(out.code.data(), p, code_count * sizeof(instruction));
+        p += code_count * sizeof(instruction);
+        std::memcpy(out.lines.data(), p, code_count * sizeof(uint64_t));
+        p += code_count * sizeof(uint64_t);
+    } else {
+        for (instruction &in : out.code) {
+            in = {static_cast<opcode>(p[0]), p[1], p[2], p[3], static_cast<int32_t>(get_u32(p + 4))};
+            p += sizeof(instruction);
+        }
+        for (uint64_t &line : out.lines) {
+            line = get_u64(p);
+            p += sizeof(uint64_t);
+        }
+    }
+
+    for (uint32_t i = 0; i < symbol_count; ++i) {
+        if (!fits(8)) return false;
+        const uint32_t address = get_u32(p);
+        const uint32_t length = get_u32(p + 4);
+        p += 8;
+        if (!fits(length)) return false;
+        out.symbols.emplace(std::string(reinterpret_cast<const char *>(p), length), address);
+        p += length;
+    }
+
+    for (uint32_t i = 0; i < segment_count; ++i) {
+        if (!fits(12)) return false;
+        segment seg = {get_u32(p), get_u32(p + 4), {}};
+        const uint32_t count = get_u32(p + 8);
+        p += 12;
+        if (count > seg.size || !fits(count)) return false;
+        seg.bytes.assign(p, p + count);
+        out.segments.push_back(std::move(seg));
+        p += count;
+    }
+
+    if (p != end || !valid_code(out)) return false;
+    prog = std::move(out);
+    return true;
+}
+
+program_cache::program_cache(std::string dir) : _dir(std::move(dir)) {
+    if (mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::invalid_argument("Cannot create cache directory " + _dir);
+
+    struct stat st = {};
+    if (stat(_dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        throw std::invalid_argument("Not a directory: " + _dir);
+}
+
+uint64_t program_cache::hash(const std::string_view bytes) {
+    // murmur3's 64 bit mixing one word at a time, then its finalizer
+    constexpr uint64_t k1 = 0x87c37b91114253d5;
+    constexpr uint64_t k2 = 0x4cf5ad432745937f;
+    const auto *p = reinterpret_cast<const uint8_t *>(bytes.data());
+
+    uint64_t h = bytes.size();
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        h ^= std::rotl(get_u64(p + i) * k1, 31) * k2;
+        h = std::rotl(h, 27) * 5 + 0x52dce729;
+    }
+
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < bytes.size(); ++i, shift += 8) tail |= static_cast<uint64_t>(p[i]) << shift;
+    h ^= std::rotl(tail * k1, 31) * k2;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+std::string program_cache::entry_path(const uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.rvc", static_cast<unsigned long long>(key));
+    return _dir + name;
+}
+
+std::vector<uint8_t> program_cache::serialize(const uint64_t key, const size_t source_size, const program &prog) {
+    std::vector<uint8_t> image;
+    image.reserve(PROGRAM_CACHE_HEADER_SIZE + prog.code.size() * (sizeof(instruction) + sizeof(uint64_t)));
+
+    put_u32(image, PROGRAM_CACHE_MAGIC);
+    image.push_back(PROGRAM_CACHE_VERSION);
+    image.push_back(static_cast<uint8_t>(INSTRUCTIONS_COUNT));
+    image.push_back(0);
+    image.push_back(0);
+    put_u64(image, key);
+    put_u64(image, source_size);
+    put_u32(image, prog.base);
+    put_u32(image, prog.entry);
+    put_u32(image, static_cast<uint32_t>(prog.code.size()));
+    put_u32(image, static_cast<uint32_t>(prog.symbols.size()));
+    put_u32(image, static_cast<uint32_t>(prog.segments.size()));
+    put_u32(image, 0);
+    image.resize(PROGRAM_CACHE_HEADER_SIZE); // payload size and hash are filled in last
+
+    for (const instruction &in : prog.code) {
+        image.push_back(static_cast<uint8_t>(in.op));
+        image.push_back(in.rd);
+        image.push_back(in.rs1);
+        image.push_back(in.rs2);
+        put_u32(image, static_cast<uint32_t>(in.imm));
+    }
+    // binaries leave lines empty, an assembled program has one per instruction
+    for (size_t i = 0; i < prog.code.size(); ++i) put_u64(image, i < prog.lines.size() ? prog.lines[i] : 0);
+
+    for (const auto &[name, address] : prog.symbols) {
+        put_u32(image, address);
+        put_u32(image, static_cast<uint32_t>(name.size()));
+        image.insert(image.end(), name.begin(), name.end());
+    }
+
+    for (const segment &seg : prog.segments) {
+        put_u32(image, seg.address);
+        put_u32(image, seg.size);
+        put_u32(image, static_cast<uint32_t>(seg.bytes.size()));
+        image.insert(image.end(), seg.bytes.begin(), seg.bytes.end());
+    }
+
+    const std::string_view payload(reinterpret_cast<const char *>(image.data()) + PROGRAM_CACHE_HEADER_SIZE,
+                                   image.size() - PROGRAM_CACHE_HEADER_SIZE);
+    const uint64_t payload_hash = hash(payload);
+    const uint64_t payload_size = payload.size();
+    for (size_t i = 0; i < 8; ++i) {
+        image[48 + i] = static_cast<uint8_t>(payload_size >> (8 * i));
+        image[56 + i] = static_cast<uint8_t>(payload_hash >> (8 * i));
+    }
+    return image;
+}
+
+bool program_cache::read(const std::string &path, const uint64_t key, const size_t source_size, program &prog) {
+    try {
+        const mapped_file file(path);
+        return decode_image(file.text(), key, source_size, prog);
+    } catch (const std::invalid_argument &) {
+        return false; // not cached yet
+    }
+}
+
+bool program_cache::write(const std::string &path, const uint64_t key, const size_t source_size, const program &prog) {
+    const std::vector<uint8_t> image = serialize(key, source_size, prog);
+
+    // readers only ever see a missing or a complete image
+    std::string temp = path + ".XXXXXX";
+    const int fd = mkstemp(temp.data());
+    if (fd < 0) return false;
+
+    bool ok = fchmod(fd, 0644) == 0;
+    for (size_t done = 0; ok && done < image.size();) {
+        const ssize_t n = ::write(fd, image.data() + done, image.size() - done);
+        ok = n > 0;
+        if (ok) done += n;
+    }
+    ok = close(fd) == 0 && ok && rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok) unlink(temp.c_str());
+    return ok;
+}
+
+program program_cache::assemble(const std::string_view source, assembler &as) const {
+    const uint64_t key = hash(source);
+    const std::string path = entry_path(key);
+    if (program prog; read(path, key, source.size(), prog)) return prog;
+
+    program prog = as.assemble(source);
+    // best effort, an image that cannot be written only costs the next run its head start
+    if (as.errors().empty()) (void)write(path, key, source.size(), prog);
+    return prog;
+}
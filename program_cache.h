@@ -0,0 +1,49 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assembler.h"
+#include "instruction.h"
+
+// file layout, all integers little endian, offsets only so the image can be mapped anywhere:
+//   "RVPC", u8 version, u8 INSTRUCTIONS_COUNT, u16 0, u64 source hash, u64 source size,
+//   u32 base, u32 entry, u32 code count, u32 symbol count, u32 segment count, u32 0,
+//   u64 payload size, u64 payload hash
+// then the payload: 8 bytes per instruction laid out like struct instruction, a u64 source
+// line per instruction, per symbol u32 address, u32 length and the name, per segment
+// u32 address, u32 size, u32 byte count and the bytes
+constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x43505652; // "RVPC"
+constexpr uint8_t  PROGRAM_CACHE_VERSION = 1;
+constexpr size_t   PROGRAM_CACHE_HEADER_SIZE = 64;
+
+// decoded assembly kept on disk under the hash of its source, one file per source.
+// a hit maps the image and copies it out, a missing, stale or corrupt image is
+// assembled again and replaced. the cache is shared safely between threads and
+// processes, images are written to a temporary file and renamed into place
+class program_cache {
+    std::string _dir;
+
+    [[nodiscard]] std::string       entry_path(uint64_t key) const;
+    [[nodiscard]] static bool       read(const std::string& path, uint64_t key, size_t source_size, program& prog);
+    [[nodiscard]] static bool       write(const std::string& path, uint64_t key, size_t source_size, const program& prog);
+    [[nodiscard]] static std::vector<uint8_t> serialize(uint64_t key, size_t source_size, const program& prog);
+public:
+    // creates dir when it is missing, throws std::invalid_argument when it cannot
+    explicit program_cache(std::string dir);
+
+    // as.assemble(source) unless the cache already holds it. sources that do not assemble
+    // cleanly are never cached, their errors come from as.errors() like before
+    [[nodiscard]] program           assemble(std::string_view source, assembler& as) const;
+    // not cryptographic, it only has to tell sources apart
+    [[nodiscard]] static uint64_t   hash(std::string_view bytes);
+};
+
+#endif //PROGRAM_CACHE_H
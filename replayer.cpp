@@ -0,0 +1,167 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "replayer.h"
+
+static void malformed() {
+    throw std::invalid_argument("Malformed trace");
+}
+
+replayer::replayer(std::istream &in, const program &prog) : _prog(prog) {
+    in.seekg(0, std::ios::end);
+    _data.resize(static_cast<size_t>(std::max<std::streamoff>(in.tellg(), 0)));
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char *>(_data.data()), static_cast<std::streamsize>(_data.size()));
+    if (!in || _data.size() < TRACE_HEADER_SIZE || u32(0) != TRACE_MAGIC)
+        throw std::invalid_argument("Not a trace file");
+    if (_data[4] != TRACE_VERSION)
+        throw std::invalid_argument("Unsupported trace version " + std::to_string(_data[4]));
+
+    _model = static_cast<memory_model>(_data[5]);
+    _memory_size = u32(6) | static_cast<uint64_t>(u32(10)) << 32;
+
+    for (size_t at = TRACE_HEADER_SIZE; at < _data.size();) {
+        if (at + TRACE_BLOCK_HEADER > _data.size()) malformed();
+
+        const size_t records = at + TRACE_BLOCK_HEADER;
+        const size_t stores = records + u32(at);
+        const size_t end = stores + u32(at + 4);
+        if (end > _data.size()) malformed();
+
+        _blocks.push_back({records, stores, end, _records});
+        _records += u32(at + 8);
+        at = end;
+    }
+    if (_blocks.empty()) malformed();
+
+    rewind();
+}
+
+uint32_t replayer::u32(const size_t at) const {
+    return _data[at] | _data[at + 1] << 8 | _data[at + 2] << 16 | static_cast<uint32_t>(_data[at + 3]) << 24;
+}
+
+uint64_t replayer::varint(size_t &at, const size_t end) const {
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (at >= end) malformed();
+
+        const uint8_t b = _data[at++];
+        value |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return value;
+    }
+    malformed();
+    return 0;
+}
+
+// registers and the pc come from the block header, memory is whatever the earlier blocks left
+void replayer::enter(const size_t b) {
+    const size_t header = _blocks[b].records - TRACE_BLOCK_HEADER;
+    _expected_pc = u32(header + 12);
+    for (size_t r = 1; r < 32; ++r) _state->registers[r] = u32(header + 12 + 4 * r);
+
+    _block = b;
+    _cursor = _blocks[b].records;
+    _store_cursor = _blocks[b].stores;
+    _index = _blocks[b].first;
+    _last_store = 0;
+}
+
+void replayer::rewind() {
+    _state = std::make_unique<cpu>(_memory_size, _model);
+    _state->map_segments(_prog);
+    enter(0);
+    _state->pc = peek_pc();
+}
+
+void replayer::apply_store() {
+    const size_t end = _blocks[_block].end;
+    const uint64_t head = varint(_store_cursor, end);
+    _last_store += unzigzag(static_cast<uint32_t>(head >> 2));
+
+    uint8_t value_bytes[4];
+    const uint8_t *bytes = value_bytes;
+    size_t width;
+    if ((head & 3) == TRACE_BULK) {
+        // the bytes are stored as they are, they are written straight from the trace
+        const uint64_t count = varint(_store_cursor, end);
+        if (count > end - _store_cursor) malformed();
+        bytes = _data.data() + _store_cursor;
+        width = static_cast<size_t>(count);
+        _store_cursor += width;
+    } else {
+        const uint32_t value = static_cast<uint32_t>(varint(_store_cursor, end));
+        width = size_t{1} << (head & 3);
+        for (size_t i = 0; i < width; ++i) value_bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    if (_model == memory_model::PAGED)
+        _state->paged.write(_last_store, bytes, width);
+    else
+        _state->memory.write(_last_store, bytes, width);
+}
+
+void replayer::apply() {
+    const size_t end = _blocks[_block].stores;
+    if (_cursor >= end) malformed();
+
+    const uint8_t tag = _data[_cursor++];
+    if (tag == TRACE_END) malformed();
+
+    uint32_t pc = _expected_pc;
+    if (tag & TRACE_JUMP) pc += unzigzag(static_cast<uint32_t>(varint(_cursor, end)));
+    _expected_pc = pc + 4;
+
+    for (uint8_t n = tag >> TRACE_REGS_SHIFT & 3; n; --n) {
+        if (_cursor >= end) malformed();
+
+        const uint8_t r = _data[_cursor++];
+        if (r == 0 || r >= 32) malformed();
+        _state->registers[r] += unzigzag(static_cast<uint32_t>(varint(_cursor, end)));
+    }
+
+    if (tag & TRACE_STORE) apply_store();
+    ++_index;
+}
+
+// the pc of the next record, or the final pc once every record is applied
+uint32_t replayer::peek_pc() const {
+    size_t at = _cursor;
+    const size_t end = _blocks[_block].stores;
+    if (at >= end) return _expected_pc;
+
+    const uint8_t tag = _data[at++];
+    if (tag == TRACE_END || tag & TRACE_JUMP) return _expected_pc + unzigzag(static_cast<uint32_t>(varint(at, end)));
+    return _expected_pc;
+}
+
+uint64_t replayer::seek(uint64_t index) {
+    if (index > _records) index = _records;
+    if (index < _index) rewind();
+
+    // the last block starting at or before index
+    const auto later = std::upper_bound(_blocks.begin(), _blocks.end(), index,
+                                        [](const uint64_t i, const block &b) { return i < b.first; });
+    const size_t target = later - _blocks.begin() - 1;
+
+    if (target > _block) {
+        // the blocks in between only matter for the memory they wrote
+        while (_block < target) {
+            while (_store_cursor < _blocks[_block].end) apply_store();
+            ++_block;
+            _store_cursor = _blocks[_block].stores;
+            _last_store = 0;
+        }
+        enter(target);
+    }
+
+    while (_index < index) apply();
+    _state->pc = peek_pc();
+    _state->retired = _index;
+    return _index;
+}
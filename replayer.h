@@ -0,0 +1,63 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef REPLAYER_H
+#define REPLAYER_H
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "cpu.h"
+#include "instruction.h"
+#include "trace.h"
+
+// rebuilds the architectural state after any number of retired instructions from a
+// trace_writer file. blocks before the target only have their stores applied, the
+// registers come from the target block's header and only its records are decoded
+class replayer {
+    struct block {
+        size_t      records;    // offset of the record stream
+        size_t      stores;     // offset of the store stream
+        size_t      end;
+        uint64_t    first;      // index of the block's first record
+    };
+
+    const program&              _prog;
+    std::vector<uint8_t>        _data;
+    std::vector<block>          _blocks;
+    memory_model                _model;
+    uint64_t                    _memory_size;
+    uint64_t                    _records = 0;
+
+    std::unique_ptr<cpu>        _state;
+    size_t                      _block = 0;         // block the cursors are in
+    size_t                      _cursor = 0;        // next record
+    size_t                      _store_cursor = 0;  // next store
+    uint64_t                    _index = 0;         // records applied to _state
+    uint32_t                    _expected_pc = 0;
+    uint32_t                    _last_store = 0;
+
+    [[nodiscard]] uint32_t  u32(size_t at) const;
+    [[nodiscard]] uint64_t  varint(size_t& at, size_t end) const;
+    void                    enter(size_t b);
+    void                    rewind();
+    void                    apply_store();
+    void                    apply();
+    [[nodiscard]] uint32_t  peek_pc() const;
+public:
+    // the program the trace was recorded from maps the initial memory,
+    // throws std::invalid_argument when the trace is not one
+    replayer(std::istream& in, const program& prog);
+
+    // state after index retired instructions, index is clamped to records().
+    // seeking backwards replays from the start
+    uint64_t                    seek(uint64_t index);
+    [[nodiscard]] const cpu&    state() const { return *_state; }
+    [[nodiscard]] uint64_t      index() const { return _index; }
+    [[nodiscard]] uint64_t      records() const { return _records; }
+};
+
+#endif //REPLAYER_H
@@ -0,0 +1,45 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "smp.h"
+
+smp::smp(const size_t harts, const uint64_t memory_size) : _memory(memory_size) {
+    if (harts == 0 || harts * HART_STACK_SIZE > _memory.size())
+        throw std::invalid_argument("Invalid hart count: " + std::to_string(harts));
+
+    // memory and the guest process are shared, registers and the engines' caches are per hart
+    _harts.reserve(harts);
+    const uint32_t top = static_cast<uint32_t>(_memory.size() & ~0xfULL);
+    _sys.limit_break(top - static_cast<uint32_t>(harts) * HART_STACK_SIZE);
+    for (size_t i = 0; i < harts; ++i) {
+        cpu &c = _harts.emplace_back(0, memory_model::FLAT);
+        c.memory = _memory.share();
+        c.sys() = _sys.share();
+        c.hart_id = static_cast<uint32_t>(i);
+        c.registers[SP] = top - static_cast<uint32_t>(i) * HART_STACK_SIZE;
+    }
+}
+
+void smp::map_segments(const program &prog) {
+    _harts.front().map_segments(prog);
+}
+
+std::vector<status> smp::execute(const program &prog, const engine mode) {
+    std::vector<status> results(_harts.size());
+    std::vector<std::thread> threads;
+    threads.reserve(_harts.size());
+
+    // a run before may have ended in exit_group, the flag is only cleared while no hart runs
+    _sys.clear_exit();
+
+    // harts only write their own cpu and result slot, prog is read only
+    for (size_t i = 0; i < _harts.size(); ++i)
+        threads.emplace_back([&, i] { results[i] = _harts[i].execute(prog, mode); });
+    for (auto &t : threads) t.join();
+    return results;
+}
@@ -0,0 +1,39 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef SMP_H
+#define SMP_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu.h"
+
+constexpr uint32_t HART_STACK_SIZE = 64 * 1024; // hart i starts with sp this much lower than hart i - 1
+
+// harts sharing one flat memory and one guest process (fds, stdout buffer and break),
+// each runs on its own host thread and tells itself apart from the others with csrr mhartid.
+//
+// memory model: lr.w, sc.w, amo*.w and fence are seq_cst host atomics on the shared
+// words, so a program that synchronizes through them behaves like on RVWMO hardware
+// or stronger. plain loads and stores are plain host accesses, aligned words do not
+// tear but two harts only agree on their order through one of the above
+class smp {
+    flat_memory         _memory;
+    syscalls            _sys;
+    std::vector<cpu>    _harts;
+public:
+    // throws std::invalid_argument for 0 harts or when the stacks do not fit in memory_size
+    explicit smp(size_t harts, uint64_t memory_size = DEFAULT_MEMORY_SIZE);
+
+    void                map_segments(const program& prog);
+    // every hart starts at the entry, returns once all of them stopped, in hart order
+    std::vector<status> execute(const program& prog, engine mode = DEFAULT_ENGINE);
+
+    [[nodiscard]] cpu&          hart(const size_t i) { return _harts[i]; }
+    [[nodiscard]] const cpu&    hart(const size_t i) const { return _harts[i]; }
+    [[nodiscard]] size_t        size() const { return _harts.size(); }
+};
+
+#endif //SMP_H
@@ -0,0 +1,175 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+
+static void put_u32(uint8_t *out, const uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static void put_u64(uint8_t *out, const uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value));
+    put_u32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+static uint64_t get_u64(const uint8_t *in) {
+    return get_u32(in) | static_cast<uint64_t>(get_u32(in + 4)) << 32;
+}
+
+static bool write_all(const int fd, const uint8_t *bytes, const size_t count, const uint64_t offset) {
+    for (size_t done = 0; done < count;) {
+        const ssize_t n = pwrite(fd, bytes + done, count - done, static_cast<off_t>(offset + done));
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+static bool read_all(const int fd, uint8_t *bytes, const size_t count, const uint64_t offset) {
+    for (size_t done = 0; done < count;) {
+        const ssize_t n = pread(fd, bytes + done, count - done, static_cast<off_t>(offset + done));
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+snapshot::snapshot(const cpu &source) :
+    _model(source.model()), _memory_size(source.memory.size()), _retired(source.retired), _fused(source.fused) {
+    std::copy_n(source.registers.begin(), _registers.size(), _registers.begin());
+    _pc = source.last_trap().cause == status::BREAKPOINT ? source.pc + 4 : source.pc;
+
+    if (_model == memory_model::PAGED) {
+        _paged = source.paged.fork();
+        return;
+    }
+
+    // laid out like the file so forks map both the same way
+    _fd = memfd_create("risc-v snapshot", MFD_CLOEXEC);
+    if (_fd < 0 || ftruncate(_fd, static_cast<off_t>(SNAPSHOT_HEADER_SIZE + _memory_size)) != 0 ||
+        !source.memory.dump(_fd, SNAPSHOT_HEADER_SIZE)) {
+        if (_fd >= 0) close(_fd);
+        throw std::invalid_argument("Cannot create snapshot image");
+    }
+}
+
+snapshot::~snapshot() {
+    if (_fd >= 0) close(_fd);
+}
+
+snapshot::snapshot(snapshot &&other) noexcept :
+    _model(other._model), _memory_size(other._memory_size), _registers(other._registers), _pc(other._pc),
+    _retired(other._retired), _fused(other._fused), _fd(std::exchange(other._fd, -1)), _paged(std::move(other._paged)) {
+}
+
+snapshot &snapshot::operator=(snapshot &&other) noexcept {
+    if (this != &other) {
+        if (_fd >= 0) close(_fd);
+        _model = other._model;
+        _memory_size = other._memory_size;
+        _registers = other._registers;
+        _pc = other._pc;
+        _retired = other._retired;
+        _fused = other._fused;
+        _fd = std::exchange(other._fd, -1);
+        _paged = std::move(other._paged);
+    }
+    return *this;
+}
+
+void snapshot::save(const std::string &path) const {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw std::invalid_argument("Cannot open snapshot file " + path);
+
+    std::vector<uint8_t> header(SNAPSHOT_HEADER_SIZE);
+    put_u32(header.data(), SNAPSHOT_MAGIC);
+    header[4] = SNAPSHOT_VERSION;
+    header[5] = static_cast<uint8_t>(_model);
+    put_u64(header.data() + 6, _memory_size);
+    put_u32(header.data() + 14, _pc);
+    put_u64(header.data() + 18, _retired);
+    for (size_t r = 0; r < _registers.size(); ++r) put_u32(header.data() + 26 + 4 * r, _registers[r]);
+    for (size_t k = 0; k < FUSED_COUNT; ++k) put_u64(header.data() + 154 + 8 * k, _fused[k]);
+
+    bool ok = write_all(fd, header.data(), header.size(), 0);
+    if (_model == memory_model::FLAT) {
+        // holes stay holes, only pages that are not all zero are copied
+        ok = ok && flat_memory(_fd, SNAPSHOT_HEADER_SIZE, _memory_size).dump(fd, SNAPSHOT_HEADER_SIZE) &&
+             ftruncate(fd, static_cast<off_t>(SNAPSHOT_HEADER_SIZE + _memory_size)) == 0;
+    } else {
+        uint64_t offset = SNAPSHOT_HEADER_SIZE;
+        uint8_t vpn_bytes[4];
+        _paged.for_each_page([&](const uint32_t vpn, const uint8_t *bytes) {
+            put_u32(vpn_bytes, vpn);
+            ok = ok && write_all(fd, vpn_bytes, 4, offset) && write_all(fd, bytes, PAGE_SIZE, offset + 4);
+            offset += 4 + PAGE_SIZE;
+        });
+    }
+
+    if (close(fd) != 0 || !ok) throw std::invalid_argument("Cannot write snapshot file " + path);
+}
+
+snapshot snapshot::load(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::invalid_argument("Cannot open snapshot file " + path);
+
+    snapshot snap;
+    snap._fd = fd; // closed by snap from here on
+
+    struct stat st = {};
+    std::vector<uint8_t> header(SNAPSHOT_HEADER_SIZE);
+    if (fstat(fd, &st) != 0 || !read_all(fd, header.data(), header.size(), 0) || get_u32(header.data()) != SNAPSHOT_MAGIC)
+        throw std::invalid_argument("Not a snapshot file: " + path);
+    if (header[4] != SNAPSHOT_VERSION)
+        throw std::invalid_argument("Unsupported snapshot version " + std::to_string(header[4]));
+
+    snap._model = static_cast<memory_model>(header[5]);
+    snap._memory_size = get_u64(header.data() + 6);
+    snap._pc = get_u32(header.data() + 14);
+    snap._retired = get_u64(header.data() + 18);
+    for (size_t r = 0; r < snap._registers.size(); ++r) snap._registers[r] = get_u32(header.data() + 26 + 4 * r);
+    for (size_t k = 0; k < FUSED_COUNT; ++k) snap._fused[k] = get_u64(header.data() + 154 + 8 * k);
+
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (snap._model == memory_model::FLAT) {
+        // a short file would fault the guest on the missing pages
+        if (size < SNAPSHOT_HEADER_SIZE + snap._memory_size) throw std::invalid_argument("Truncated snapshot file: " + path);
+        return snap;
+    }
+
+    std::vector<uint8_t> page(4 + PAGE_SIZE);
+    for (uint64_t offset = SNAPSHOT_HEADER_SIZE; offset < size; offset += page.size()) {
+        if (!read_all(fd, page.data(), page.size(), offset)) throw std::invalid_argument("Truncated snapshot file: " + path);
+        snap._paged.write(get_u32(page.data()) << PAGE_SHIFT, page.data() + 4, PAGE_SIZE);
+    }
+    close(std::exchange(snap._fd, -1));
+    return snap;
+}
+
+cpu snapshot::fork() const {
+    cpu c(0, _model);
+    if (_model == memory_model::FLAT)
+        c.memory = flat_memory(_fd, SNAPSHOT_HEADER_SIZE, _memory_size);
+    else
+        c.paged = _paged.fork();
+
+    std::copy(_registers.begin(), _registers.end(), c.registers.begin());
+    c.pc = _pc;
+    c.retired = _retired;
+    c.fused = _fused;
+    return c;
+}
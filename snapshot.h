@@ -0,0 +1,61 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cpu.h"
+#include "instruction.h"
+#include "memory.h"
+
+// file layout, all integers little endian, the header is padded to a page:
+//   "RVSN", u8 version, u8 memory model, u64 memory size, u32 pc, u64 retired,
+//   u32 x[32], u64 fused[FUSED_COUNT]
+// then for the flat model the raw memory image, sparse where pages are zero,
+// and for the paged model one u32 vpn and PAGE_SIZE bytes per resident page
+constexpr uint32_t SNAPSHOT_MAGIC = 0x4e535652; // "RVSN"
+constexpr uint8_t  SNAPSHOT_VERSION = 1;
+constexpr size_t   SNAPSHOT_HEADER_SIZE = PAGE_SIZE;
+
+// the whole machine at one point: registers, pc, counters and guest memory. every
+// cpu forked from it shares the memory copy on write, a flat image is kept in a
+// memfd (or the file it was loaded from) and mapped privately, paged memory shares
+// its pages. the snapshot itself is never written after it is taken
+class snapshot {
+    memory_model                            _model = memory_model::FLAT;
+    uint64_t                                _memory_size = 0;
+    std::array<uint32_t, 32>                _registers = {};
+    uint32_t                                _pc = 0;
+    uint64_t                                _retired = 0;
+    std::array<uint64_t, FUSED_COUNT>       _fused = {};
+    int                                     _fd = -1; // flat image at SNAPSHOT_HEADER_SIZE
+    paged_memory                            _paged;
+
+    snapshot() = default;
+public:
+    // a cpu stopped on ebreak is captured past it, forks resume with the next instruction.
+    // throws std::invalid_argument when the image cannot be created
+    explicit snapshot(const cpu& source);
+    ~snapshot();
+    snapshot(const snapshot&) = delete;
+    snapshot& operator=(const snapshot&) = delete;
+    snapshot(snapshot&& other) noexcept;
+    snapshot& operator=(snapshot&& other) noexcept;
+
+    // flat images are mapped straight from the file, throws std::invalid_argument
+    [[nodiscard]] static snapshot load(const std::string& path);
+    // throws std::invalid_argument
+    void                        save(const std::string& path) const;
+
+    // costs a mapping (flat) or a copy of the page tables (paged), no guest memory is copied
+    [[nodiscard]] cpu           fork() const;
+    [[nodiscard]] memory_model  model() const { return _model; }
+    [[nodiscard]] uint32_t      pc() const { return _pc; }
+};
+
+#endif //SNAPSHOT_H
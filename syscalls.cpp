@@ -0,0 +1,346 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "syscalls.h"
+
+// open flags as the guest passes them, the generic linux values
+constexpr uint32_t GUEST_O_ACCMODE = 0x3;
+constexpr uint32_t GUEST_O_CREAT = 0100;
+constexpr uint32_t GUEST_O_EXCL = 0200;
+constexpr uint32_t GUEST_O_TRUNC = 01000;
+constexpr uint32_t GUEST_O_APPEND = 02000;
+constexpr uint32_t GUEST_O_NONBLOCK = 04000;
+constexpr uint32_t GUEST_O_DIRECTORY = 0200000;
+constexpr uint32_t GUEST_O_NOFOLLOW = 0400000;
+constexpr int32_t  GUEST_AT_FDCWD = -100;
+
+// newlib's struct kernel_stat, a timespec there is 64 bit seconds and 32 bit nanoseconds padded to 16 bytes
+constexpr size_t GUEST_STAT_SIZE = 128;
+constexpr size_t GUEST_TIMESPEC_SIZE = 16;
+
+static void put_u32(uint8_t *out, const uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static void put_u64(uint8_t *out, const uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value));
+    put_u32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+static void put_timespec(uint8_t *out, const timespec &ts) {
+    put_u64(out, static_cast<uint64_t>(ts.tv_sec));
+    put_u32(out + 8, static_cast<uint32_t>(ts.tv_nsec));
+}
+
+static int host_open_flags(const uint32_t flags) {
+    int host = static_cast<int>(flags & GUEST_O_ACCMODE);
+    if (flags & GUEST_O_CREAT) host |= O_CREAT;
+    if (flags & GUEST_O_EXCL) host |= O_EXCL;
+    if (flags & GUEST_O_TRUNC) host |= O_TRUNC;
+    if (flags & GUEST_O_APPEND) host |= O_APPEND;
+    if (flags & GUEST_O_NONBLOCK) host |= O_NONBLOCK;
+    if (flags & GUEST_O_DIRECTORY) host |= O_DIRECTORY;
+    if (flags & GUEST_O_NOFOLLOW) host |= O_NOFOLLOW;
+
+    // guest fds never survive an exec of the host
+    return host | O_CLOEXEC;
+}
+
+// false when the string runs out of guest memory or past PATH_MAX
+static bool guest_string(const cpu &c, uint32_t addr, std::string &out) {
+    out.clear();
+    for (; out.size() < PATH_MAX; ++addr) {
+        const uint8_t *byte = c.model() == memory_model::PAGED ? c.paged.readable(addr) : c.memory.host(addr, 1);
+        if (!byte) return false;
+        if (*byte == 0) return true;
+
+        out.push_back(static_cast<char>(*byte));
+    }
+    return false;
+}
+
+syscalls::process::~process() {
+    flush();
+    for (const int fd : fds)
+        if (fd > 2) close(fd);
+}
+
+syscalls syscalls::share() const {
+    syscalls view;
+    view._process = _process;
+    return view;
+}
+
+void syscalls::bind(const program &prog) {
+    const std::lock_guard guard(_process->lock);
+    if (_process->break_start != 0) return;
+
+    uint64_t end = prog.base + prog.code.size() * 4;
+    for (const auto &seg : prog.segments) end = std::max<uint64_t>(end, static_cast<uint64_t>(seg.address) + seg.size);
+
+    _process->break_start = _process->brk = static_cast<uint32_t>(std::min<uint64_t>((end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1ULL), UINT32_MAX & ~(PAGE_SIZE - 1)));
+}
+
+void syscalls::limit_break(const uint32_t limit) {
+    const std::lock_guard guard(_process->lock);
+    _process->break_limit = limit;
+}
+
+bool syscalls::gather(cpu &c, uint32_t addr, uint32_t count, const bool store) {
+    _iov.clear();
+    if (static_cast<uint64_t>(addr) + count > (1ULL << 32)) return false;
+
+    if (c.model() == memory_model::FLAT) {
+        uint8_t *bytes = c.memory.host(addr, count);
+        if (!bytes) return false;
+
+        _iov.push_back({bytes, count});
+        return true;
+    }
+
+    // pages are not contiguous on the host, a longer buffer is transferred in part
+    while (count > 0 && _iov.size() < IOV_MAX) {
+        const uint32_t chunk = std::min<uint32_t>(count, PAGE_SIZE - (addr & (PAGE_SIZE - 1)));
+        uint8_t *bytes = store ? c.paged.writable(addr) : const_cast<uint8_t *>(c.paged.readable(addr));
+        _iov.push_back({bytes, chunk});
+        addr += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+bool syscalls::copy_out(cpu &c, const uint32_t addr, const uint8_t *bytes, const uint32_t count) {
+    if (!gather(c, addr, count, true)) return false;
+
+    for (const iovec &v : _iov) {
+        std::copy_n(bytes, v.iov_len, static_cast<uint8_t *>(v.iov_base));
+        bytes += v.iov_len;
+    }
+    _written = addr;
+    _written_count = count;
+    return true;
+}
+
+// both with lock held
+int syscalls::process::host_fd(const uint32_t fd) const {
+    return fd < fds.size() ? fds[fd] : -1;
+}
+
+void syscalls::process::flush() {
+    if (capture) {
+        captured.append(out.begin(), out.end());
+        out.clear();
+        return;
+    }
+
+    for (size_t done = 0; done < out.size();) {
+        const ssize_t n = ::write(STDOUT_FILENO, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    out.clear();
+}
+
+void syscalls::flush() {
+    const std::lock_guard guard(_process->lock);
+    _process->flush();
+}
+
+void syscalls::capture_output() {
+    const std::lock_guard guard(_process->lock);
+    _process->flush();
+    _process->capture = true;
+}
+
+std::string syscalls::output() {
+    const std::lock_guard guard(_process->lock);
+    _process->flush();
+    return std::exchange(_process->captured, {});
+}
+
+bool syscalls::call(cpu &c) {
+    _written_count = 0;
+
+    int32_t result;
+    switch (c.registers[A7]) {
+        case SYS_OPENAT:        result = sys_openat(c); break;
+        case SYS_CLOSE:         result = sys_close(c.registers[A0]); break;
+        case SYS_READ:          result = sys_read(c); break;
+        case SYS_WRITE:         result = sys_write(c); break;
+        case SYS_FSTAT:         result = sys_fstat(c); break;
+        case SYS_CLOCK_GETTIME: result = sys_clock_gettime(c); break;
+        case SYS_BRK:           result = sys_brk(c); break;
+        case SYS_EXIT_GROUP:
+            _process->exit_code = static_cast<int32_t>(c.registers[A0]);
+            _process->exited.store(true, std::memory_order_release);
+            flush();
+            return false;
+        case SYS_EXIT:
+            flush();
+            return false;
+        default:                result = -ENOSYS; break;
+    }
+
+    c.registers[A0] = static_cast<uint32_t>(result);
+    return true;
+}
+
+int32_t syscalls::sys_openat(cpu &c) {
+    std::string path;
+    if (!guest_string(c, c.registers[A1], path)) return -EFAULT;
+
+    process &p = *_process;
+    const std::lock_guard guard(p.lock);
+    const auto dir_fd = static_cast<int32_t>(c.registers[A0]);
+    const int dir = dir_fd == GUEST_AT_FDCWD ? AT_FDCWD : p.host_fd(static_cast<uint32_t>(dir_fd));
+    if (dir == -1) return -EBADF;
+
+    const int host = openat(dir, path.c_str(), host_open_flags(c.registers[A2]), static_cast<mode_t>(c.registers[A3]));
+    if (host < 0) return -errno;
+
+    // the lowest free guest fd, like the kernel hands them out
+    const auto slot = std::find(p.fds.begin(), p.fds.end(), -1);
+    if (slot != p.fds.end()) {
+        *slot = host;
+        return static_cast<int32_t>(slot - p.fds.begin());
+    }
+    p.fds.push_back(host);
+    return static_cast<int32_t>(p.fds.size() - 1);
+}
+
+int32_t syscalls::sys_close(const uint32_t fd) {
+    process &p = *_process;
+    const std::lock_guard guard(p.lock);
+    const int host = p.host_fd(fd);
+    if (host < 0) return -EBADF;
+
+    if (host == STDOUT_FILENO) p.flush();
+    p.fds[fd] = -1;
+    if (host > 2 && close(host) != 0) return -errno;
+    return 0;
+}
+
+int32_t syscalls::sys_read(cpu &c) {
+    int host;
+    {
+        // a prompt written before the read has to be visible. the read itself may block,
+        // the other harts keep their calls meanwhile
+        const std::lock_guard guard(_process->lock);
+        host = _process->host_fd(c.registers[A0]);
+        if (host < 0) return -EBADF;
+        _process->flush();
+    }
+    const uint32_t count = std::min<uint32_t>(c.registers[A2], INT32_MAX);
+    if (!gather(c, c.registers[A1], count, true)) return -EFAULT;
+
+    const ssize_t n = readv(host, _iov.data(), static_cast<int>(_iov.size()));
+    if (n < 0) return -errno;
+
+    _written = c.registers[A1];
+    _written_count = static_cast<uint32_t>(n);
+    return static_cast<int32_t>(n);
+}
+
+int32_t syscalls::sys_write(cpu &c) {
+    process &p = *_process;
+    const std::lock_guard guard(p.lock);
+    const int host = p.host_fd(c.registers[A0]);
+    if (host < 0) return -EBADF;
+
+    const uint32_t count = std::min<uint32_t>(c.registers[A2], INT32_MAX);
+    if (!gather(c, c.registers[A1], count, false)) return -EFAULT;
+
+    // small writes to stdout only cost a copy until the buffer fills, captured ones always do
+    if (host == STDOUT_FILENO && (count < OUTPUT_BUFFER_SIZE || p.capture)) {
+        if (p.out.size() + count > OUTPUT_BUFFER_SIZE) p.flush();
+        if (p.out.capacity() < OUTPUT_BUFFER_SIZE) p.out.reserve(OUTPUT_BUFFER_SIZE);
+
+        for (const iovec &v : _iov) {
+            const auto *bytes = static_cast<const uint8_t *>(v.iov_base);
+            p.out.insert(p.out.end(), bytes, bytes + v.iov_len);
+        }
+        return static_cast<int32_t>(count);
+    }
+
+    // anything else goes out in order after what is already buffered
+    p.flush();
+    const ssize_t n = writev(host, _iov.data(), static_cast<int>(_iov.size()));
+    return n < 0 ? -errno : static_cast<int32_t>(n);
+}
+
+int32_t syscalls::sys_fstat(cpu &c) {
+    struct stat st = {};
+    {
+        const std::lock_guard guard(_process->lock);
+        const int host = _process->host_fd(c.registers[A0]);
+        if (host < 0) return -EBADF;
+        if (fstat(host, &st) != 0) return -errno;
+    }
+
+    uint8_t out[GUEST_STAT_SIZE] = {};
+    put_u64(out, st.st_dev);
+    put_u64(out + 8, st.st_ino);
+    put_u32(out + 16, st.st_mode);
+    put_u32(out + 20, static_cast<uint32_t>(st.st_nlink));
+    put_u32(out + 24, st.st_uid);
+    put_u32(out + 28, st.st_gid);
+    put_u64(out + 32, st.st_rdev);
+    put_u64(out + 48, static_cast<uint64_t>(st.st_size));
+    put_u32(out + 56, static_cast<uint32_t>(st.st_blksize));
+    put_u64(out + 64, static_cast<uint64_t>(st.st_blocks));
+    put_timespec(out + 72, st.st_atim);
+    put_timespec(out + 72 + GUEST_TIMESPEC_SIZE, st.st_mtim);
+    put_timespec(out + 72 + 2 * GUEST_TIMESPEC_SIZE, st.st_ctim);
+
+    return copy_out(c, c.registers[A1], out, GUEST_STAT_SIZE) ? 0 : -EFAULT;
+}
+
+int32_t syscalls::sys_clock_gettime(cpu &c) {
+    // realtime through boottime, the ids match on every linux host
+    const uint32_t clock = c.registers[A0];
+    if (clock > CLOCK_BOOTTIME) return -EINVAL;
+
+    timespec ts = {};
+    if (clock_gettime(static_cast<clockid_t>(clock), &ts) != 0) return -errno;
+
+    uint8_t out[GUEST_TIMESPEC_SIZE] = {};
+    put_timespec(out, ts);
+    return copy_out(c, c.registers[A1], out, GUEST_TIMESPEC_SIZE) ? 0 : -EFAULT;
+}
+
+int32_t syscalls::sys_brk(cpu &c) {
+    process &p = *_process;
+    const std::lock_guard guard(p.lock);
+
+    // the heap may grow up to the stack pointer, a refused request returns the old break
+    const uint32_t target = c.registers[A0];
+    if (target < p.break_start || target >= c.registers[SP] || target >= p.break_limit ||
+        (c.model() == memory_model::FLAT && target > c.memory.size()))
+        return static_cast<int32_t>(p.brk);
+
+    // memory given back reads as zero once it is handed out again
+    if (target < p.brk) {
+        if (c.model() == memory_model::FLAT)
+            c.memory.clear(target, p.brk - target);
+        else {
+            const uint32_t head = std::min<uint32_t>(p.brk, (target + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1)) - target;
+            c.paged.clear(target, head);
+            c.paged.release(target, p.brk - target);
+        }
+    }
+    p.brk = target;
+    return static_cast<int32_t>(p.brk);
+}
@@ -0,0 +1,105 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef SYSCALLS_H
+#define SYSCALLS_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+#include "instruction.h"
+
+class cpu;
+
+// the generic linux numbers riscv uses, newlib's libgloss issues the same ones
+constexpr uint32_t SYS_OPENAT = 56;
+constexpr uint32_t SYS_CLOSE = 57;
+constexpr uint32_t SYS_READ = 63;
+constexpr uint32_t SYS_WRITE = 64;
+constexpr uint32_t SYS_FSTAT = 80;
+constexpr uint32_t SYS_EXIT = 93;
+constexpr uint32_t SYS_EXIT_GROUP = 94;
+constexpr uint32_t SYS_CLOCK_GETTIME = 113;
+constexpr uint32_t SYS_BRK = 214;
+
+constexpr size_t OUTPUT_BUFFER_SIZE = 64 * 1024; // writes to fd 1 smaller than this are coalesced
+
+// the ecall handler. the number comes in a7, arguments in a0 to a5 and the result goes
+// back in a0, failures are -errno like linux returns them. guest buffers are handed to
+// readv and writev in place, one iovec per page on the paged model.
+// guest fds index a table of host fds, 0 to 2 are the host's own and are never closed.
+// the fds, the stdout buffer and the break belong to the guest process, every view from
+// share() sees the same ones and a call holds their lock while it touches them
+class syscalls {
+    struct process {
+        std::mutex              lock;
+        std::vector<int>        fds = {0, 1, 2};    // -1 once closed
+        std::vector<uint8_t>    out;                // writes to fd 1 not flushed yet
+        bool                    capture = false;    // fd 1 is flushed into captured, not the host's
+        std::string             captured;
+        uint32_t                break_start = 0;    // 0 until bind
+        uint32_t                brk = 0;
+        uint32_t                break_limit = UINT32_MAX;
+        std::atomic<bool>       exited{false};      // set by exit_group, it stays set
+        int32_t                 exit_code = 0;
+
+        ~process();
+        [[nodiscard]] int       host_fd(uint32_t fd) const;
+        void                    flush();
+    };
+
+    std::shared_ptr<process> _process = std::make_shared<process>();
+    std::vector<iovec>      _iov;
+    uint32_t                _written = 0;       // guest range the last call stored to
+    uint32_t                _written_count = 0;
+
+    [[nodiscard]] bool      gather(cpu& c, uint32_t addr, uint32_t count, bool store);
+    [[nodiscard]] bool      copy_out(cpu& c, uint32_t addr, const uint8_t* bytes, uint32_t count);
+
+    [[nodiscard]] int32_t   sys_openat(cpu& c);
+    [[nodiscard]] int32_t   sys_close(uint32_t fd);
+    [[nodiscard]] int32_t   sys_read(cpu& c);
+    [[nodiscard]] int32_t   sys_write(cpu& c);
+    [[nodiscard]] int32_t   sys_fstat(cpu& c);
+    [[nodiscard]] int32_t   sys_clock_gettime(cpu& c);
+    [[nodiscard]] int32_t   sys_brk(cpu& c);
+public:
+    syscalls() = default;
+    syscalls(const syscalls&) = delete;
+    syscalls& operator=(const syscalls&) = delete;
+    syscalls(syscalls&&) noexcept = default;
+    syscalls& operator=(syscalls&&) noexcept = default;
+
+    // a view of the same process for another hart, the last view left closes its fds
+    [[nodiscard]] syscalls  share() const;
+    // the heap starts on the first page past the program, only the first call counts
+    void                    bind(const program& prog);
+    // the break stays below limit, smp keeps the heap out of the harts' stacks
+    void                    limit_break(uint32_t limit);
+    // false once the guest asked to exit, a0 holds its code. exit stops the calling hart,
+    // exit_group every hart of the process: the engines check exit_flag() at least once per
+    // jump, so a hart spinning on a lock the exiting one held stops too
+    [[nodiscard]] bool      call(cpu& c);
+    [[nodiscard]] const std::atomic<bool>& exit_flag() const { return _process->exited; }
+    // what exit_group was called with, once exit_flag() is set
+    [[nodiscard]] int32_t   exit_code() const { return _process->exit_code; }
+    // smp clears it before its harts start again
+    void                    clear_exit() { _process->exited.store(false); }
+    void                    flush();
+    // from now on what the guest writes to fd 1 is kept for output() instead of reaching
+    // the host stdout, so a batch report on stdout stays clean
+    void                    capture_output();
+    // everything captured so far, taken out
+    [[nodiscard]] std::string output();
+    // what the last call stored to guest memory, for the tracer
+    [[nodiscard]] uint32_t  written() const { return _written; }
+    [[nodiscard]] uint32_t  written_count() const { return _written_count; }
+};
+
+#endif //SYSCALLS_H
@@ -0,0 +1,94 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+
+#include "thread_pool.h"
+
+// which worker of which pool the calling thread is, submit() uses it to stay local
+static thread_local const thread_pool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+thread_pool::thread_pool(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < threads; ++i) _queues.push_back(std::make_unique<queue>());
+    for (size_t i = 0; i < threads; ++i) _workers.emplace_back(&thread_pool::run, this, i);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard guard(_lock);
+        _stopping = true;
+    }
+    _work.notify_all();
+    for (auto &w : _workers) w.join();
+}
+
+void thread_pool::submit(task t) {
+    // counted first so no worker can finish it before it is counted, and under _lock
+    // so a worker cannot miss it between its check and its wait
+    {
+        std::lock_guard guard(_lock);
+        ++_queued;
+        ++_unfinished;
+    }
+
+    const size_t target = current_pool == this ? current_worker : _next++ % _queues.size();
+    {
+        std::lock_guard guard(_queues[target]->lock);
+        _queues[target]->tasks.push_back(std::move(t));
+    }
+    _work.notify_one();
+}
+
+bool thread_pool::take(const size_t self, task &out) {
+    {
+        queue &own = *_queues[self];
+        std::lock_guard guard(own.lock);
+        if (!own.tasks.empty()) {
+            out = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --_queued;
+            return true;
+        }
+    }
+
+    // the oldest task of a victim is the one its owner would get to last
+    for (size_t i = 1; i < _queues.size(); ++i) {
+        queue &victim = *_queues[(self + i) % _queues.size()];
+        std::lock_guard guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+
+        out = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        --_queued;
+        return true;
+    }
+    return false;
+}
+
+void thread_pool::run(const size_t self) {
+    current_pool = this;
+    current_worker = self;
+
+    while (true) {
+        if (task t; take(self, t)) {
+            t();
+
+            std::lock_guard guard(_lock);
+            if (--_unfinished == 0) _done.notify_all();
+            continue;
+        }
+
+        std::unique_lock guard(_lock);
+        _work.wait(guard, [this] { return _stopping || _queued > 0; });
+        if (_stopping && _queued == 0) return;
+    }
+}
+
+void thread_pool::wait() {
+    std::unique_lock guard(_lock);
+    _done.wait(guard, [this] { return _unfinished == 0; });
+}
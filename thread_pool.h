@@ -0,0 +1,53 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed workers with a deque each. a worker runs tasks from the back of its own deque
+// and steals from the front of the others once it is empty. tasks submitted from a
+// worker go to its own deque, the rest are dealt out round robin. tasks must not throw
+class thread_pool {
+    using task = std::function<void()>;
+
+    struct queue {
+        std::mutex          lock;
+        std::deque<task>    tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> _queues;
+    std::vector<std::thread>            _workers;
+    std::atomic<size_t>                 _queued = 0; // submitted and not taken yet
+    std::atomic<size_t>                 _next = 0;
+    std::mutex                          _lock;       // guards the two below
+    size_t                              _unfinished = 0;
+    bool                                _stopping = false;
+    std::condition_variable             _work;
+    std::condition_variable             _done;
+
+    [[nodiscard]] bool  take(size_t self, task& out);
+    void                run(size_t self);
+public:
+    // 0 threads means one per host core
+    explicit thread_pool(size_t threads = 0);
+    ~thread_pool();
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    void                    submit(task t);
+    // blocks until every task submitted so far has finished, never call it from a task
+    void                    wait();
+    [[nodiscard]] size_t    size() const { return _workers.size(); }
+};
+
+#endif //THREAD_POOL_H
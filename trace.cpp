@@ -0,0 +1,130 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "trace.h"
+
+static void put_u32(uint8_t *out, const uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+trace_writer::trace_writer(const std::string &path, const memory_model model, const uint64_t memory_size,
+                           const uint32_t entry, const uint32_t *registers) :
+    _out(path, std::ios::binary), _expected_pc(entry) {
+    if (!_out)
+        throw std::invalid_argument("Cannot open trace file " + path);
+
+    std::vector<uint8_t> header(TRACE_HEADER_SIZE);
+    put_u32(header.data(), TRACE_MAGIC);
+    header[4] = TRACE_VERSION;
+    header[5] = static_cast<uint8_t>(model);
+    put_u32(header.data() + 6, static_cast<uint32_t>(memory_size));
+    put_u32(header.data() + 10, static_cast<uint32_t>(memory_size >> 32));
+    std::copy(registers, registers + 32, _shadow.begin());
+
+    _io = std::thread(&trace_writer::drain, this);
+    submit(std::move(header));
+    start_block();
+}
+
+trace_writer::~trace_writer() {
+    if (_io.joinable()) {
+        {
+            std::lock_guard guard(_lock);
+            _closing = true;
+        }
+        _ready.notify_all();
+        _io.join();
+    }
+}
+
+void trace_writer::drain() {
+    std::unique_lock guard(_lock);
+    while (true) {
+        _ready.wait(guard, [this] { return _closing || !_pending.empty(); });
+        if (_pending.empty()) return;
+
+        std::vector<uint8_t> block = std::move(_pending.front());
+        _pending.pop_front();
+
+        // the executor keeps filling the next block while this one goes to disk
+        guard.unlock();
+        _out.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+        const bool failed = !_out;
+        guard.lock();
+
+        _failed = _failed || failed;
+        _free.push_back(std::move(block));
+        _ready.notify_all();
+    }
+}
+
+void trace_writer::submit(std::vector<uint8_t> &&block) {
+    {
+        std::lock_guard guard(_lock);
+        _pending.push_back(std::move(block));
+    }
+    _ready.notify_all();
+}
+
+// the block header is filled in by flush, only the registers are known up front
+void trace_writer::start_block() {
+    _block.resize(TRACE_BLOCK_HEADER + TRACE_BLOCK_SIZE + TRACE_STORES_SIZE);
+    put_u32(_block.data() + 12, _expected_pc);
+    for (size_t r = 1; r < 32; ++r) put_u32(_block.data() + 12 + 4 * r, _shadow[r]);
+
+    _cursor = _block.data() + TRACE_BLOCK_HEADER;
+    _store_used = 0;
+    _last_store = 0;
+}
+
+void trace_writer::flush() {
+    const size_t record_bytes = _cursor - _block.data() - TRACE_BLOCK_HEADER;
+    const size_t store_bytes = _store_used;
+    if (record_bytes == 0) return;
+
+    put_u32(_block.data(), static_cast<uint32_t>(record_bytes));
+    put_u32(_block.data() + 4, static_cast<uint32_t>(store_bytes));
+    put_u32(_block.data() + 8, _records);
+    _block.resize(TRACE_BLOCK_HEADER + record_bytes + store_bytes);
+    std::memcpy(_block.data() + TRACE_BLOCK_HEADER + record_bytes, _stores.data(), store_bytes);
+    submit(std::move(_block));
+    _records = 0;
+
+    // reuse a written block, or allocate while fewer than TRACE_BUFFERS exist
+    {
+        std::unique_lock guard(_lock);
+        _ready.wait(guard, [this] { return !_free.empty() || _allocated < TRACE_BUFFERS; });
+        if (!_free.empty()) {
+            _block = std::move(_free.back());
+            _free.pop_back();
+        } else {
+            _block = {};
+            ++_allocated;
+        }
+    }
+    start_block();
+}
+
+bool trace_writer::finish(const uint32_t pc) {
+    if (!_io.joinable()) return !_failed;
+
+    if (full(0)) flush();
+    *_cursor++ = TRACE_END;
+    varint(_cursor, zigzag(static_cast<int32_t>(pc - _expected_pc)));
+    flush();
+
+    {
+        std::lock_guard guard(_lock);
+        _closing = true;
+    }
+    _ready.notify_all();
+    _io.join();
+
+    _out.flush();
+    return !_failed && _out;
+}
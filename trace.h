@@ -0,0 +1,173 @@
+//
+// Created by Antonie Gabriel Belu on 17.10.2026.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "instruction.h"
+#include "memory.h"
+
+// file layout, all integers little endian:
+//   header  "RVTR", u8 version, u8 memory model, u64 memory size
+//   blocks  u32 record bytes, u32 store bytes, u32 records, u32 pc, u32 x1..x31, records, stores
+// every retired instruction is one record, a tag byte followed by the fields it announces.
+// deltas are zigzag varints, pc against the previous pc + 4 and registers against their
+// previous value. stores live in their own stream so a replay can skip a block by applying
+// its stores alone, each is a varint of (zigzag address delta << 2 | log2 width) and a varint
+// value, or with TRACE_BULK in place of the width a varint byte count and the raw bytes, which
+// is how a syscall's whole buffer is one store. the block header holds the registers at its
+// start. the trace ends with TRACE_END and the final pc delta
+constexpr uint32_t TRACE_MAGIC = 0x52545652; // "RVTR"
+constexpr uint8_t  TRACE_VERSION = 2;
+constexpr size_t   TRACE_HEADER_SIZE = 4 + 1 + 1 + 8;
+constexpr size_t   TRACE_BLOCK_HEADER = 3 * 4 + 32 * 4;
+constexpr size_t   TRACE_BLOCK_SIZE = 64 * 1024; // bytes of records
+constexpr size_t   TRACE_STORES_SIZE = 16 * 1024; // a block only goes past it for one bulk store
+constexpr size_t   TRACE_MAX_RECORD = 16;
+constexpr size_t   TRACE_MAX_STORE = 16;
+constexpr size_t   TRACE_BUFFERS = 8; // blocks in flight before the executor waits for the disk
+
+constexpr uint8_t  TRACE_JUMP = 0x01;      // pc delta follows
+constexpr uint8_t  TRACE_STORE = 0x02;     // the next entry of the store stream is this record's
+constexpr uint8_t  TRACE_REGS_SHIFT = 2;   // register writes, 0 to 2, each a u8 index and a delta
+constexpr uint8_t  TRACE_BULK = 3;         // in a store's width bits, a byte count and the bytes follow
+constexpr uint8_t  TRACE_END = 0xff;
+
+[[nodiscard]] constexpr uint32_t zigzag(const int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+[[nodiscard]] constexpr int32_t unzigzag(const uint32_t v) {
+    return static_cast<int32_t>((v >> 1) ^ (0 - (v & 1)));
+}
+
+// buffers records into blocks, a background thread writes full blocks so the
+// executor only waits when TRACE_BUFFERS blocks are queued behind the disk
+class trace_writer {
+    std::ofstream                       _out;
+    std::thread                         _io;
+    std::mutex                          _lock;
+    std::condition_variable             _ready;
+    std::deque<std::vector<uint8_t>>    _pending;
+    std::vector<std::vector<uint8_t>>   _free;
+    size_t                              _allocated = 1;
+    bool                                _closing = false;
+    bool                                _failed = false;
+
+    std::vector<uint8_t>                _block;
+    uint8_t*                            _cursor = nullptr;
+    uint8_t*                            _tag = nullptr;
+    std::vector<uint8_t>                _stores = std::vector<uint8_t>(TRACE_STORES_SIZE);
+    size_t                              _store_used = 0;
+    uint32_t                            _records = 0;
+    uint64_t                            _total = 0;
+
+    std::array<uint32_t, 32>            _shadow = {}; // register values as the trace last left them
+    uint32_t                            _expected_pc = 0;
+    uint32_t                            _last_store = 0;
+
+    static void varint(uint8_t*& out, uint64_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(value);
+    }
+
+    [[nodiscard]] bool full(const size_t store_bytes) const {
+        return _cursor + TRACE_MAX_RECORD > _block.data() + TRACE_BLOCK_HEADER + TRACE_BLOCK_SIZE ||
+               _store_used + TRACE_MAX_STORE + store_bytes > TRACE_STORES_SIZE;
+    }
+
+    // a record's stores cannot move to the next block, the buffer grows instead
+    uint8_t* store_space(const size_t bytes) {
+        if (_store_used + bytes > _stores.size()) _stores.resize(_store_used + bytes);
+        return _stores.data() + _store_used;
+    }
+
+    void store_head(const uint32_t addr, const uint8_t width) {
+        uint8_t *out = store_space(TRACE_MAX_STORE);
+        varint(out, static_cast<uint64_t>(zigzag(static_cast<int32_t>(addr - _last_store))) << 2 | width);
+        _store_used = out - _stores.data();
+        _last_store = addr;
+    }
+
+    void    start_block();
+    void    flush();
+    void    submit(std::vector<uint8_t>&& block);
+    void    drain();
+public:
+    // registers is the register file before the first instruction,
+    // throws std::invalid_argument when path cannot be opened
+    trace_writer(const std::string& path, memory_model model, uint64_t memory_size, uint32_t entry,
+                 const uint32_t* registers);
+    ~trace_writer();
+    trace_writer(const trace_writer&) = delete;
+    trace_writer& operator=(const trace_writer&) = delete;
+
+    // a record is begin(), reg() for every register the instruction may have written,
+    // at most one store() or store_bulk() after them and commit(). bulk_bytes is the size
+    // of the bulk store to come, so the block is flushed before the record when it won't fit
+    void begin(const uint32_t pc, const size_t bulk_bytes = 0) {
+        if (full(bulk_bytes)) flush();
+
+        _tag = _cursor++;
+        *_tag = 0;
+        if (pc != _expected_pc) {
+            *_tag |= TRACE_JUMP;
+            varint(_cursor, zigzag(static_cast<int32_t>(pc - _expected_pc)));
+        }
+        _expected_pc = pc + 4;
+    }
+
+    // records the register only when its value changed, writes to x0 never do
+    void reg(const uint8_t r, const uint32_t value) {
+        if (r == 0 || r >= 32 || _shadow[r] == value) return;
+
+        *_tag += 1 << TRACE_REGS_SHIFT;
+        *_cursor++ = r;
+        varint(_cursor, zigzag(static_cast<int32_t>(value - _shadow[r])));
+        _shadow[r] = value;
+    }
+
+    void store(const uint32_t addr, const uint8_t width_log2, const uint32_t value) {
+        *_tag |= TRACE_STORE;
+        store_head(addr, width_log2);
+        uint8_t *out = store_space(TRACE_MAX_STORE);
+        varint(out, value);
+        _store_used = out - _stores.data();
+    }
+
+    // count bytes at addr, the caller fills them in through the returned pointer
+    // before anything else is recorded
+    uint8_t* store_bulk(const uint32_t addr, const uint32_t count) {
+        *_tag |= TRACE_STORE;
+        store_head(addr, TRACE_BULK);
+        uint8_t *out = store_space(TRACE_MAX_STORE + count);
+        varint(out, count);
+        _store_used = out - _stores.data() + count;
+        return out;
+    }
+
+    void commit() {
+        ++_records;
+        ++_total;
+    }
+
+    // writes the end marker and waits for the i/o thread, false when any write failed
+    bool                    finish(uint32_t pc);
+    [[nodiscard]] uint64_t  records() const { return _total; }
+};
+
+#endif //TRACE_H